@@ -0,0 +1,529 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <bx/bx.h>
+#include <bx/commandline.h>
+#include <bx/fpumath.h>
+#include <bx/rng.h>
+#include <bx/timer.h>
+#include "IWindowManager.hpp"
+#include "EventBuffer.hpp"
+#include "WindowGroups.hpp"
+#include "DesktopSpace.hpp"
+#include "Utils.hpp"
+#include "Allocations.hpp"
+#include "JobSystem.hpp"
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const unsigned int gWindowCounts[] = { 10, 100, 1000, 10000 };
+static const unsigned int gWindowsPerGroup = 8;
+static const unsigned int gScreenWidth = 1920;
+static const unsigned int gScreenHeight = 1080;
+// Larger than most cursor themes, the conversion does not depend on the
+// number of windows
+static const unsigned int gCursorSize = 64;
+// Each case is repeated until it has run for this long
+static const double gMinRunTime = 0.2;
+static const unsigned int gMinIterations = 3;
+// Like the application's frame jobs
+static const unsigned int gNumWorkers = 3;
+static const unsigned int gNumControllers = 2;
+static const unsigned int gMaxTransformBatches = 64;
+static const unsigned int gMinTransformBatchSize = 32;
+
+// Keeps results alive so the work is not optimized away
+static volatile float gSink;
+
+// The parts of Application the core algorithms touch, without the HMD,
+// the window system or the renderer
+class BenchWindowManager: public IWindowManager
+{
+public:
+	void init(unsigned int numWindows, uint32_t seed)
+	{
+		DisplayMetrics metrics;
+		metrics.mWidthInPixels = gScreenWidth;
+		metrics.mHeightInPixels = gScreenHeight;
+		metrics.mWidthInMeters = 0.5f;
+		metrics.mHeightInMeters = 0.28f;
+		mDesktopSpace.init(metrics);
+
+		bx::RngMwc rng(seed);
+		for(unsigned int i = 0; i < numWindows; ++i)
+		{
+			WindowInfo info;
+			info.mTexture = BGFX_INVALID_HANDLE;
+			info.mInvertedY = false;
+			info.mPID = i / gWindowsPerGroup + 1;
+			info.mWidth = 64 + rng.gen() % 1024;
+			info.mHeight = 64 + rng.gen() % 768;
+			info.mX = (int)(rng.gen() % (gScreenWidth - info.mWidth / 2));
+			info.mY = (int)(rng.gen() % (gScreenHeight - info.mHeight / 2));
+			addWindow(i + 1, info);
+		}
+	}
+
+	void addWindow(WindowId window, const WindowInfo& info)
+	{
+		mWindows[window] = info;
+
+		bool created;
+		WindowGroup& group = mGroups.addWindow(info.mPID, window, created);
+		if(!created) { return; }
+
+		// Groups are spread around the viewer like a user would
+		float yaw = (float)(info.mPID % 16) * bx::pi / 8.f;
+		float rotation[16];
+		bx::mtxRotateY(rotation, yaw);
+		float translation[16];
+		bx::mtxTranslate(translation, 0.f, 0.f, -1.f);
+		bx::mtxMul(group.mTransform, translation, rotation);
+	}
+
+	void removeWindow(WindowId window)
+	{
+		auto itr = mWindows.find(window);
+		if(itr == mWindows.end()) { return; }
+
+		mGroups.removeWindow(itr->second.mPID, window);
+		mWindows.erase(itr);
+	}
+
+	unsigned int getWindowGroups(const PID** pids)
+	{
+		*pids = mGroups.getPIDs().data();
+		return (unsigned int)mGroups.getPIDs().size();
+	}
+
+	unsigned int getWindows(PID pid, const WindowId** wids)
+	{
+		mTmpWindows.clear();
+		if(pid)
+		{
+			const WindowGroup* group = mGroups.find(pid);
+			if(group != NULL)
+			{
+				mTmpWindows.assign(group->mMembers.begin(), group->mMembers.end());
+			}
+		}
+		else
+		{
+			for(auto&& pair: mWindows) { mTmpWindows.push_back(pair.first); }
+		}
+
+		*wids = mTmpWindows.data();
+		return (unsigned int)mTmpWindows.size();
+	}
+
+	bool getGroupTransform(PID pid, float* result)
+	{
+		const WindowGroup* group = mGroups.find(pid);
+		if(group == NULL) { return false; }
+
+		memcpy(result, group->mTransform, sizeof(group->mTransform));
+		return true;
+	}
+
+	bool setGroupTransform(PID pid, const float* mtx)
+	{
+		WindowGroup* group = mGroups.find(pid);
+		if(group == NULL) { return false; }
+
+		memcpy(group->mTransform, mtx, sizeof(group->mTransform));
+		return true;
+	}
+
+	bool transformPoint(PID pid, unsigned int x, unsigned int y, float* out)
+	{
+		const WindowGroup* group = mGroups.find(pid);
+		if(group == NULL) { return false; }
+
+		mDesktopSpace.transformPoint(group->mTransform, (float)x, (float)y, out);
+		return true;
+	}
+
+	bool setFocusedWindow(WindowId window)
+	{
+		BX_UNUSED(window);
+		return true;
+	}
+
+	WindowId getFocusedWindow()
+	{
+		return 0;
+	}
+
+	const WindowInfo* getWindowInfo(WindowId window)
+	{
+		auto itr = mWindows.find(window);
+		return itr != mWindows.end() ? &itr->second : NULL;
+	}
+
+	WindowTable mWindows;
+	WindowGroups mGroups;
+	DesktopSpace mDesktopSpace;
+	std::vector<WindowId> mTmpWindows;
+	std::vector<DrawItem> mDrawItems;
+};
+
+struct BenchContext;
+
+struct TransformBatch
+{
+	BenchContext* mCtx;
+	unsigned int mBegin;
+	unsigned int mEnd;
+};
+
+struct BenchContext
+{
+	~BenchContext()
+	{
+		if(mJobSystem.getNumWorkers() > 0) { mJobSystem.shutdown(); }
+	}
+
+	BenchWindowManager mWindowManager;
+	EventBuffer mEventBuffer;
+	bx::RngMwc mRng;
+	unsigned int mNumWindows;
+	std::vector<uint32_t> mCursorImage;
+	std::vector<uint8_t> mCursorPixels;
+	// Only started by the cases using it
+	JobSystem mJobSystem;
+	TransformBatch mTransformBatches[gMaxTransformBatches];
+	JobSystem::Job* mTransformJobs[gMaxTransformBatches];
+};
+
+typedef void(*BenchFn)(BenchContext& ctx);
+
+struct BenchCase
+{
+	const char* mName;
+	BenchFn mFn;
+	// Runs every frame of a static scene so it must not allocate once
+	// warmed up
+	bool mSteadyState;
+	// Otherwise only run with the smallest window count
+	bool mPerWindow;
+};
+
+struct BenchResult
+{
+	// Nanoseconds per call
+	double mTime;
+	double mAllocations;
+};
+
+// A ray from the viewer through a random point of the view
+void benchPickWindow(BenchContext& ctx)
+{
+	float rayOrigin[] = { 0.f, 0.f, 0.f };
+	float rayDirection[] = {
+		(float)(ctx.mRng.gen() % 1000) / 1000.f - 0.5f,
+		(float)(ctx.mRng.gen() % 1000) / 1000.f - 0.5f,
+		-1.f
+	};
+	bx::vec3Norm(rayDirection, rayDirection);
+	gSink = (float)utils::pickWindow(
+		&ctx.mWindowManager, rayOrigin, rayDirection
+	);
+}
+
+// One drain of the X event queue: every window moves, most get damaged
+// twice and a tenth of them are mapped then unmapped again
+void benchCoalesceEvents(BenchContext& ctx)
+{
+	EventBuffer& buffer = ctx.mEventBuffer;
+	buffer.clear();
+
+	BufferedEvent event;
+	event.mTime = 0;
+	for(unsigned int i = 0; i < ctx.mNumWindows; ++i)
+	{
+		WindowId window = i + 1;
+
+		event.mType = WindowEvent::WindowUpdated;
+		event.mWindow = window;
+		event.mX = (int)i;
+		event.mY = (int)i;
+		event.mWidth = 640;
+		event.mHeight = 480;
+		event.mFields = WindowEvent::Position | WindowEvent::Size;
+		buffer.push(event);
+
+		event.mFields = WindowEvent::Content;
+		buffer.push(event);
+		buffer.push(event);
+
+		if(i % 10 == 0)
+		{
+			WindowId transient = ctx.mNumWindows + window;
+			event.mType = WindowEvent::WindowAdded;
+			event.mWindow = transient;
+			event.mFields = 0;
+			buffer.push(event);
+			event.mType = WindowEvent::WindowRemoved;
+			buffer.push(event);
+		}
+	}
+
+	gSink = (float)buffer.size();
+}
+
+// A random window is unmapped and mapped again
+void benchWindowChurn(BenchContext& ctx)
+{
+	BenchWindowManager& wm = ctx.mWindowManager;
+	WindowId window = ctx.mRng.gen() % ctx.mNumWindows + 1;
+	WindowInfo info = *wm.getWindowInfo(window);
+	wm.removeWindow(window);
+	wm.addWindow(window, info);
+	gSink = (float)wm.mGroups.getPIDs().size();
+}
+
+// The cursor drawn over every window group
+void benchCursorTransform(BenchContext& ctx)
+{
+	BenchWindowManager& wm = ctx.mWindowManager;
+
+	CursorInfo cursorInfo;
+	cursorInfo.mTexture = BGFX_INVALID_HANDLE;
+	cursorInfo.mOriginX = 4;
+	cursorInfo.mOriginY = 4;
+	cursorInfo.mWidth = 16;
+	cursorInfo.mHeight = 16;
+	int mouseX = (int)(ctx.mRng.gen() % gScreenWidth);
+	int mouseY = (int)(ctx.mRng.gen() % gScreenHeight);
+
+	float sum = 0.f;
+	for(auto&& pair: wm.mGroups)
+	{
+		float cursorTransform[16];
+		wm.mDesktopSpace.getCursorTransform(
+			pair.second.mTransform, mouseX, mouseY, cursorInfo, 0.001f,
+			cursorTransform
+		);
+		sum += cursorTransform[12];
+	}
+	gSink = sum;
+}
+
+// XWindow converts every new cursor image before uploading it
+void benchCursorImage(BenchContext& ctx)
+{
+	uint32_t numPixels = gCursorSize * gCursorSize;
+	if(ctx.mCursorImage.empty())
+	{
+		ctx.mCursorImage.resize(numPixels);
+		for(uint32_t& pixel: ctx.mCursorImage) { pixel = ctx.mRng.gen(); }
+		ctx.mCursorPixels.resize(numPixels * 4);
+	}
+
+	utils::convertCursorImage(
+		ctx.mCursorImage.data(), numPixels, ctx.mCursorPixels.data()
+	);
+	gSink = ctx.mCursorPixels[ctx.mRng.gen() % ctx.mCursorPixels.size()];
+}
+
+// What the main loop does before submitting: build the draw list and
+// compute every window's transform
+void benchTransformPipeline(BenchContext& ctx)
+{
+	BenchWindowManager& wm = ctx.mWindowManager;
+	wm.mGroups.getDrawItems(wm.mWindows, wm.mDrawItems);
+	wm.mDesktopSpace.computeTransforms(
+		wm.mDrawItems.data(), (unsigned int)wm.mDrawItems.size()
+	);
+	gSink = wm.mDrawItems.empty() ? 0.f : wm.mDrawItems.back().mTransform[12];
+}
+
+// Stands in for the HMD and controller updates, which need no heap either
+void benchFrameJob(void* userData)
+{
+	BenchContext& ctx = *static_cast<BenchContext*>(userData);
+	gSink = (float)ctx.mWindowManager.getFocusedWindow();
+}
+
+void benchTransformJob(void* userData)
+{
+	const TransformBatch& batch = *static_cast<TransformBatch*>(userData);
+	BenchWindowManager& wm = batch.mCtx->mWindowManager;
+	wm.mDesktopSpace.computeTransforms(
+		&wm.mDrawItems[batch.mBegin], batch.mEnd - batch.mBegin
+	);
+}
+
+// The main loop's job graph: HMD update, controllers in order then the
+// transform batches, on the workers as well as the calling thread
+void benchFrameJobs(BenchContext& ctx)
+{
+	JobSystem& jobSystem = ctx.mJobSystem;
+	if(jobSystem.getNumWorkers() == 0) { jobSystem.init(gNumWorkers); }
+
+	jobSystem.reset();
+	JobSystem::Job* lastJob = jobSystem.create("hmd update", benchFrameJob, &ctx);
+	jobSystem.schedule(lastJob);
+	for(unsigned int i = 0; i < gNumControllers; ++i)
+	{
+		JobSystem::Job* controllerJob =
+			jobSystem.create("controller", benchFrameJob, &ctx);
+		jobSystem.addDependency(controllerJob, lastJob);
+		jobSystem.schedule(controllerJob);
+		lastJob = controllerJob;
+	}
+	jobSystem.wait(lastJob);
+
+	BenchWindowManager& wm = ctx.mWindowManager;
+	wm.mGroups.getDrawItems(wm.mWindows, wm.mDrawItems);
+	unsigned int numItems = (unsigned int)wm.mDrawItems.size();
+	unsigned int batchSize = std::max(
+		gMinTransformBatchSize,
+		(numItems + gMaxTransformBatches - 1) / gMaxTransformBatches
+	);
+	unsigned int numBatches = 0;
+	for(unsigned int begin = 0; begin < numItems; begin += batchSize)
+	{
+		TransformBatch& batch = ctx.mTransformBatches[numBatches];
+		batch.mCtx = &ctx;
+		batch.mBegin = begin;
+		batch.mEnd = std::min(begin + batchSize, numItems);
+		JobSystem::Job* job =
+			jobSystem.create("transform", benchTransformJob, &batch);
+		jobSystem.schedule(job);
+		ctx.mTransformJobs[numBatches++] = job;
+	}
+	for(unsigned int i = 0; i < numBatches; ++i)
+	{
+		jobSystem.wait(ctx.mTransformJobs[i]);
+	}
+
+	gSink = wm.mDrawItems.empty() ? 0.f : wm.mDrawItems.back().mTransform[12];
+}
+
+static const BenchCase gBenchCases[] =
+{
+	{ "pickWindow", benchPickWindow, true, true },
+	{ "coalesceEvents", benchCoalesceEvents, true, true },
+	{ "windowChurn", benchWindowChurn, false, true },
+	{ "cursorTransform", benchCursorTransform, true, true },
+	{ "cursorImage", benchCursorImage, true, false },
+	{ "transformPipeline", benchTransformPipeline, true, true },
+	{ "frameJobs", benchFrameJobs, true, true }
+};
+
+BenchResult runCase(const BenchCase& benchCase, unsigned int numWindows)
+{
+	BenchContext ctx;
+	ctx.mNumWindows = numWindows;
+	ctx.mRng.reset(numWindows);
+	ctx.mWindowManager.init(numWindows, numWindows);
+
+	// Warm up caches and containers
+	benchCase.mFn(ctx);
+
+	int64_t frequency = bx::getHPFrequency();
+	int64_t minRunTime = (int64_t)(gMinRunTime * (double)frequency);
+	// Jobs run by the workers count as well
+	uint64_t startAllocations = AllocationCounter::getThreadAllocations()
+		+ ctx.mJobSystem.getWorkerAllocations();
+	int64_t start = bx::getHPCounter();
+	int64_t elapsed = 0;
+	unsigned int numIterations = 0;
+	while(elapsed < minRunTime || numIterations < gMinIterations)
+	{
+		benchCase.mFn(ctx);
+		++numIterations;
+		elapsed = bx::getHPCounter() - start;
+	}
+
+	BenchResult result;
+	result.mTime =
+		(double)elapsed * 1e9 / (double)frequency / (double)numIterations;
+	result.mAllocations =
+		(double)(
+			AllocationCounter::getThreadAllocations()
+			+ ctx.mJobSystem.getWorkerAllocations()
+			- startAllocations
+		) / (double)numIterations;
+	return result;
+}
+
+int showHelp()
+{
+	printf("Usage: xveearr-bench [ --filter <Name> ]\n");
+	printf("\n");
+	printf("    --help                  Print this message\n");
+	printf("    --filter <Name>         Only run cases whose name contains Name\n");
+	printf("\n");
+	printf("Cases, * must not allocate:\n");
+	printf("\n");
+	for(const BenchCase& benchCase: gBenchCases)
+	{
+		printf("%c %s\n", benchCase.mSteadyState ? '*' : '-', benchCase.mName);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace xveearr;
+
+	bx::CommandLine cmdLine(argc, argv);
+	if(cmdLine.hasArg("help")) { return showHelp(); }
+
+	const char* filter = cmdLine.findOption("filter");
+	// Keeps the job system's startup lines out of the table
+	Log::setLogLevel(Log::Warn);
+
+	printf("%-20s %8s %14s %14s %12s\n",
+		"case", "windows", "ns/call", "ns/window", "allocs/call");
+	bool allocated = false;
+	for(const BenchCase& benchCase: gBenchCases)
+	{
+		if(filter && strstr(benchCase.mName, filter) == NULL) { continue; }
+
+		for(unsigned int numWindows: gWindowCounts)
+		{
+			BenchResult result = runCase(benchCase, numWindows);
+			if(benchCase.mPerWindow)
+			{
+				printf("%-20s %8u %14.1f %14.3f %12.2f\n",
+					benchCase.mName, numWindows,
+					result.mTime, result.mTime / (double)numWindows,
+					result.mAllocations
+				);
+			}
+			else
+			{
+				printf("%-20s %8s %14.1f %14s %12.2f\n",
+					benchCase.mName, "-", result.mTime, "-", result.mAllocations
+				);
+			}
+			fflush(stdout);
+
+			if(benchCase.mSteadyState && result.mAllocations > 0.0)
+			{
+				fprintf(stderr,
+					"%s allocates with %u windows\n", benchCase.mName, numWindows
+				);
+				allocated = true;
+			}
+
+			if(!benchCase.mPerWindow) { break; }
+		}
+	}
+
+	return allocated ? EXIT_FAILURE : EXIT_SUCCESS;
+}
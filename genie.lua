@@ -86,6 +86,40 @@ solution "xveearr"
 			"NoNativeWChar"
 		}
 
+	project "xveearr-bench"
+		kind "ConsoleApp"
+		language "C++"
+
+		includedirs {
+			"deps/bx/include",
+			"deps/bgfx/include",
+			"src"
+		}
+
+		configuration { "vs*" }
+			includedirs {
+				"deps/bx/include/compat/msvc"
+			}
+
+		files {
+			"bench/*.cpp",
+			"src/Utils.cpp",
+			"src/EventBuffer.cpp",
+			"src/WindowGroups.cpp",
+			"src/DesktopSpace.cpp",
+			"src/Allocations.cpp"
+		}
+
+		flags {
+			"ExtraWarnings",
+			"FatalWarnings",
+			"OptimizeSpeed",
+			"StaticRuntime",
+			"Symbols",
+			"NoEditAndContinue",
+			"NoNativeWChar"
+		}
+
 	project "bgfx"
 		kind "StaticLib"
 		language "C++"
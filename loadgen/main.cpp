@@ -0,0 +1,517 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <xcb/xcb.h>
+#include <bx/bx.h>
+#include <bx/commandline.h>
+#include <bx/os.h>
+#include <bx/rng.h>
+#include <bx/timer.h>
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const unsigned int gDefaultNumWindows = 100;
+static const unsigned int gDefaultNumProcesses = 10;
+static const unsigned int gDefaultMinWidth = 160;
+static const unsigned int gDefaultMinHeight = 120;
+static const unsigned int gDefaultMaxWidth = 640;
+static const unsigned int gDefaultMaxHeight = 480;
+// Events per second in each process
+static const double gDefaultUpdateRate = 100.0;
+static const double gDefaultMoveRate = 10.0;
+static const double gDefaultResizeRate = 1.0;
+static const unsigned int gDefaultBurstSize = 0;
+static const double gDefaultBurstInterval = 2.0;
+// Rows redrawn by a content update
+static const unsigned int gUpdateBandHeight = 32;
+// Events are not made up for stalls longer than this (in seconds)
+static const double gMaxCatchUpTime = 0.25;
+static const uint32_t gTickMs = 1;
+
+struct LoadGenCfg
+{
+	unsigned int mNumWindows;
+	unsigned int mNumProcesses;
+	unsigned int mMinWidth;
+	unsigned int mMinHeight;
+	unsigned int mMaxWidth;
+	unsigned int mMaxHeight;
+	double mUpdateRate;
+	double mMoveRate;
+	double mResizeRate;
+	// Windows unmapped together, then mapped again together
+	unsigned int mBurstSize;
+	double mBurstInterval;
+	// In seconds, 0 runs until interrupted
+	double mDuration;
+	uint32_t mSeed;
+};
+
+struct LoadWindow
+{
+	xcb_window_t mId;
+	int mX;
+	int mY;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	bool mMapped;
+	uint32_t mFrame;
+};
+
+static volatile sig_atomic_t gQuit = 0;
+
+void onSignal(int signal)
+{
+	BX_UNUSED(signal);
+	gQuit = 1;
+}
+
+bool parseSize(const char* str, unsigned int& width, unsigned int& height)
+{
+	return sscanf(str, "%ux%u", &width, &height) == 2
+		&& width > 0 && height > 0;
+}
+
+// One X client with its own connection, so the server sees it as a
+// separate process and XWindow puts its windows in their own group
+class LoadGenerator
+{
+public:
+	LoadGenerator()
+		:mConn(NULL)
+		,mScreen(NULL)
+		,mGC(0)
+		,mPendingUpdates(0.0)
+		,mPendingMoves(0.0)
+		,mPendingResizes(0.0)
+		,mBurstUnmapped(false)
+		,mNumUpdates(0)
+		,mNumMoves(0)
+		,mNumResizes(0)
+		,mNumBursts(0)
+	{}
+
+	bool init(const LoadGenCfg& cfg, unsigned int numWindows, uint32_t seed)
+	{
+		mCfg = cfg;
+		mRng.reset(seed);
+
+		mConn = xcb_connect(NULL, NULL);
+		XVR_ENSURE(
+			!xcb_connection_has_error(mConn), "Could not connect to X server"
+		);
+		mScreen = xcb_setup_roots_iterator(xcb_get_setup(mConn)).data;
+		XVR_ENSURE(mScreen != NULL, "Could not find a screen");
+
+		mGC = xcb_generate_id(mConn);
+		uint32_t gcValues[] = { mScreen->white_pixel, 0 };
+		xcb_create_gc(
+			mConn, mGC, mScreen->root,
+			XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, gcValues
+		);
+
+		mWindows.reserve(numWindows);
+		for(unsigned int i = 0; i < numWindows; ++i)
+		{
+			LoadWindow window;
+			window.mId = xcb_generate_id(mConn);
+			randomizeSize(window);
+			randomizePosition(window);
+			window.mMapped = true;
+			window.mFrame = mRng.gen();
+
+			uint32_t values[] = { mScreen->black_pixel };
+			xcb_create_window(
+				mConn, XCB_COPY_FROM_PARENT, window.mId, mScreen->root,
+				(int16_t)window.mX, (int16_t)window.mY,
+				(uint16_t)window.mWidth, (uint16_t)window.mHeight, 0,
+				XCB_WINDOW_CLASS_INPUT_OUTPUT, mScreen->root_visual,
+				XCB_CW_BACK_PIXEL, values
+			);
+			static const char title[] = "xveearr-loadgen";
+			xcb_change_property(
+				mConn, XCB_PROP_MODE_REPLACE, window.mId,
+				XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+				sizeof(title) - 1, title
+			);
+			xcb_map_window(mConn, window.mId);
+			mWindows.push_back(window);
+		}
+
+		XVR_ENSURE(xcb_flush(mConn) > 0, "Could not create windows");
+		return true;
+	}
+
+	void shutdown()
+	{
+		if(mConn == NULL) { return; }
+
+		// Windows go away with the connection
+		xcb_disconnect(mConn);
+		mConn = NULL;
+		mWindows.clear();
+	}
+
+	bool run()
+	{
+		int64_t frequency = bx::getHPFrequency();
+		int64_t start = bx::getHPCounter();
+		int64_t lastTick = start;
+		int64_t nextBurst = start + (int64_t)(mCfg.mBurstInterval * frequency);
+
+		while(!gQuit)
+		{
+			int64_t now = bx::getHPCounter();
+			if(mCfg.mDuration > 0.0
+				&& now - start >= (int64_t)(mCfg.mDuration * frequency))
+			{
+				break;
+			}
+
+			double dt = std::min(
+				(double)(now - lastTick) / (double)frequency, gMaxCatchUpTime
+			);
+			lastTick = now;
+
+			mPendingUpdates += dt * mCfg.mUpdateRate;
+			for(; mPendingUpdates >= 1.0; mPendingUpdates -= 1.0)
+			{
+				updateContent(pickWindow());
+			}
+
+			mPendingMoves += dt * mCfg.mMoveRate;
+			for(; mPendingMoves >= 1.0; mPendingMoves -= 1.0)
+			{
+				moveWindow(pickWindow());
+			}
+
+			mPendingResizes += dt * mCfg.mResizeRate;
+			for(; mPendingResizes >= 1.0; mPendingResizes -= 1.0)
+			{
+				resizeWindow(pickWindow());
+			}
+
+			if(mCfg.mBurstSize > 0 && now >= nextBurst)
+			{
+				burst();
+				nextBurst = now + (int64_t)(mCfg.mBurstInterval * frequency);
+			}
+
+			XVR_ENSURE(
+				xcb_flush(mConn) > 0 && !xcb_connection_has_error(mConn),
+				"Lost connection to X server"
+			);
+
+			// Errors are not fatal, a window may be gone already
+			xcb_generic_event_t* event;
+			while((event = xcb_poll_for_event(mConn))) { free(event); }
+
+			bx::sleep(gTickMs);
+		}
+
+		XVR_LOG(Info,
+			"Process ", getpid(), ": ", mWindows.size(), " window(s), ",
+			mNumUpdates, " update(s), ", mNumMoves, " move(s), ",
+			mNumResizes, " resize(s), ", mNumBursts, " burst(s)"
+		);
+
+		return true;
+	}
+
+private:
+	LoadWindow& pickWindow()
+	{
+		return mWindows[mRng.gen() % mWindows.size()];
+	}
+
+	void randomizeSize(LoadWindow& window)
+	{
+		window.mWidth = mCfg.mMinWidth
+			+ mRng.gen() % (mCfg.mMaxWidth - mCfg.mMinWidth + 1);
+		window.mHeight = mCfg.mMinHeight
+			+ mRng.gen() % (mCfg.mMaxHeight - mCfg.mMinHeight + 1);
+	}
+
+	void randomizePosition(LoadWindow& window)
+	{
+		unsigned int maxX = mScreen->width_in_pixels > window.mWidth
+			? mScreen->width_in_pixels - window.mWidth
+			: 0;
+		unsigned int maxY = mScreen->height_in_pixels > window.mHeight
+			? mScreen->height_in_pixels - window.mHeight
+			: 0;
+		window.mX = (int)(mRng.gen() % (maxX + 1));
+		window.mY = (int)(mRng.gen() % (maxY + 1));
+	}
+
+	// Redraws a band which scrolls down the window, like a damaged region
+	void updateContent(LoadWindow& window)
+	{
+		if(!window.mMapped) { return; }
+
+		++window.mFrame;
+		uint32_t color = (window.mFrame * 2654435761u) & 0xffffff;
+		xcb_change_gc(mConn, mGC, XCB_GC_FOREGROUND, &color);
+
+		unsigned int bandHeight = std::min(gUpdateBandHeight, window.mHeight);
+		unsigned int numBands = window.mHeight / bandHeight;
+		xcb_rectangle_t rect;
+		rect.x = 0;
+		rect.y = (int16_t)((window.mFrame % numBands) * bandHeight);
+		rect.width = (uint16_t)window.mWidth;
+		rect.height = (uint16_t)bandHeight;
+		xcb_poly_fill_rectangle(mConn, window.mId, mGC, 1, &rect);
+		++mNumUpdates;
+	}
+
+	void moveWindow(LoadWindow& window)
+	{
+		randomizePosition(window);
+		uint32_t values[] = { (uint32_t)window.mX, (uint32_t)window.mY };
+		xcb_configure_window(
+			mConn, window.mId, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, values
+		);
+		++mNumMoves;
+	}
+
+	void resizeWindow(LoadWindow& window)
+	{
+		randomizeSize(window);
+		uint32_t values[] = { window.mWidth, window.mHeight };
+		xcb_configure_window(
+			mConn, window.mId,
+			XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, values
+		);
+		++mNumResizes;
+	}
+
+	// Alternately unmaps a random set of windows and maps them back
+	void burst()
+	{
+		if(mBurstUnmapped)
+		{
+			for(unsigned int index: mBurstWindows)
+			{
+				xcb_map_window(mConn, mWindows[index].mId);
+				mWindows[index].mMapped = true;
+			}
+			mBurstWindows.clear();
+		}
+		else
+		{
+			unsigned int burstSize = std::min(
+				mCfg.mBurstSize, (unsigned int)mWindows.size()
+			);
+			for(unsigned int i = 0; i < burstSize; ++i)
+			{
+				unsigned int index = mRng.gen() % mWindows.size();
+				if(!mWindows[index].mMapped) { continue; }
+
+				xcb_unmap_window(mConn, mWindows[index].mId);
+				mWindows[index].mMapped = false;
+				mBurstWindows.push_back(index);
+			}
+		}
+
+		mBurstUnmapped = !mBurstUnmapped;
+		++mNumBursts;
+	}
+
+	LoadGenCfg mCfg;
+	bx::RngMwc mRng;
+	xcb_connection_t* mConn;
+	xcb_screen_t* mScreen;
+	xcb_gcontext_t mGC;
+	std::vector<LoadWindow> mWindows;
+	std::vector<unsigned int> mBurstWindows;
+	double mPendingUpdates;
+	double mPendingMoves;
+	double mPendingResizes;
+	bool mBurstUnmapped;
+	unsigned int mNumUpdates;
+	unsigned int mNumMoves;
+	unsigned int mNumResizes;
+	unsigned int mNumBursts;
+};
+
+int showHelp()
+{
+	printf("Usage: xveearr-loadgen --help\n");
+	printf("       xveearr-loadgen [ --windows <N> ] [ --processes <M> ]\n");
+	printf("                       [ --min-size <W>x<H> ] [ --max-size <W>x<H> ]\n");
+	printf("                       [ --update-rate <N> ] [ --move-rate <N> ]\n");
+	printf("                       [ --resize-rate <N> ] [ --burst-size <N> ]\n");
+	printf("                       [ --burst-interval <Seconds> ]\n");
+	printf("                       [ --duration <Seconds> ] [ --seed <N> ]\n");
+	printf("\n");
+	printf("    --help                  Print this message\n");
+	printf("    --windows <N>           Number of windows over all processes\n");
+	printf("    --processes <M>         Number of X clients they are spread over\n");
+	printf("    --min-size <W>x<H>\n");
+	printf("    --max-size <W>x<H>      Range of window sizes\n");
+	printf("    --update-rate <N>       Content updates per second and process\n");
+	printf("    --move-rate <N>         Moves per second and process\n");
+	printf("    --resize-rate <N>       Resizes per second and process\n");
+	printf("    --burst-size <N>        Windows unmapped and mapped together\n");
+	printf("    --burst-interval <Seconds>\n");
+	printf("                            Time between bursts\n");
+	printf("    --duration <Seconds>    Run time, until interrupted if 0\n");
+	printf("    --seed <N>              Seed for window activity\n");
+
+	return EXIT_SUCCESS;
+}
+
+bool parseCfg(const bx::CommandLine& cmdLine, LoadGenCfg& cfg)
+{
+	const char* numWindowsStr = cmdLine.findOption("windows");
+	cfg.mNumWindows = numWindowsStr
+		? (unsigned int)atoi(numWindowsStr)
+		: gDefaultNumWindows;
+	const char* numProcessesStr = cmdLine.findOption("processes");
+	cfg.mNumProcesses = numProcessesStr
+		? (unsigned int)atoi(numProcessesStr)
+		: gDefaultNumProcesses;
+	XVR_ENSURE(
+		cfg.mNumWindows > 0 && cfg.mNumProcesses > 0,
+		"There must be at least one window and one process"
+	);
+	cfg.mNumProcesses = std::min(cfg.mNumProcesses, cfg.mNumWindows);
+
+	cfg.mMinWidth = gDefaultMinWidth;
+	cfg.mMinHeight = gDefaultMinHeight;
+	cfg.mMaxWidth = gDefaultMaxWidth;
+	cfg.mMaxHeight = gDefaultMaxHeight;
+	const char* minSizeStr = cmdLine.findOption("min-size");
+	XVR_ENSURE(
+		minSizeStr == NULL || parseSize(minSizeStr, cfg.mMinWidth, cfg.mMinHeight),
+		"Invalid minimum size: ", minSizeStr
+	);
+	const char* maxSizeStr = cmdLine.findOption("max-size");
+	XVR_ENSURE(
+		maxSizeStr == NULL || parseSize(maxSizeStr, cfg.mMaxWidth, cfg.mMaxHeight),
+		"Invalid maximum size: ", maxSizeStr
+	);
+	XVR_ENSURE(
+		cfg.mMinWidth <= cfg.mMaxWidth && cfg.mMinHeight <= cfg.mMaxHeight
+		&& cfg.mMaxWidth <= UINT16_MAX && cfg.mMaxHeight <= UINT16_MAX,
+		"Invalid window size range"
+	);
+
+	const char* updateRateStr = cmdLine.findOption("update-rate");
+	cfg.mUpdateRate = updateRateStr ? atof(updateRateStr) : gDefaultUpdateRate;
+	const char* moveRateStr = cmdLine.findOption("move-rate");
+	cfg.mMoveRate = moveRateStr ? atof(moveRateStr) : gDefaultMoveRate;
+	const char* resizeRateStr = cmdLine.findOption("resize-rate");
+	cfg.mResizeRate = resizeRateStr ? atof(resizeRateStr) : gDefaultResizeRate;
+	const char* burstSizeStr = cmdLine.findOption("burst-size");
+	cfg.mBurstSize = burstSizeStr
+		? (unsigned int)atoi(burstSizeStr)
+		: gDefaultBurstSize;
+	const char* burstIntervalStr = cmdLine.findOption("burst-interval");
+	cfg.mBurstInterval = burstIntervalStr
+		? atof(burstIntervalStr)
+		: gDefaultBurstInterval;
+	const char* durationStr = cmdLine.findOption("duration");
+	cfg.mDuration = durationStr ? atof(durationStr) : 0.0;
+	const char* seedStr = cmdLine.findOption("seed");
+	cfg.mSeed = seedStr ? (uint32_t)strtoul(seedStr, NULL, 10) : 12345;
+
+	XVR_ENSURE(
+		cfg.mUpdateRate >= 0.0 && cfg.mMoveRate >= 0.0
+		&& cfg.mResizeRate >= 0.0 && cfg.mBurstInterval > 0.0
+		&& cfg.mDuration >= 0.0,
+		"Rates and times must not be negative"
+	);
+
+	return true;
+}
+
+int runProcess(const LoadGenCfg& cfg, unsigned int processIndex)
+{
+	// Windows are spread as evenly as possible
+	unsigned int numWindows = cfg.mNumWindows / cfg.mNumProcesses
+		+ (processIndex < cfg.mNumWindows % cfg.mNumProcesses ? 1 : 0);
+
+	LoadGenerator generator;
+	bool succeeded = generator.init(cfg, numWindows, cfg.mSeed + processIndex)
+		&& generator.run();
+	generator.shutdown();
+
+	return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace xveearr;
+
+	bx::CommandLine cmdLine(argc, argv);
+	if(cmdLine.hasArg("help")) { return showHelp(); }
+
+	LoadGenCfg cfg;
+	if(!parseCfg(cmdLine, cfg)) { return EXIT_FAILURE; }
+
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	XVR_LOG(Info,
+		"Creating ", cfg.mNumWindows, " window(s) in ",
+		cfg.mNumProcesses, " process(es)"
+	);
+
+	// Each child needs its own X connection so nothing is opened before
+	// forking
+	std::vector<pid_t> children;
+	for(unsigned int i = 0; i < cfg.mNumProcesses; ++i)
+	{
+		pid_t pid = fork();
+		if(pid == 0) { _exit(runProcess(cfg, i)); }
+
+		if(pid < 0)
+		{
+			XVR_LOG(Error, "Could not start process ", i);
+			gQuit = 1;
+			break;
+		}
+
+		children.push_back(pid);
+	}
+
+	int exitCode = EXIT_SUCCESS;
+	for(pid_t child: children)
+	{
+		if(gQuit) { kill(child, SIGTERM); }
+
+		int status = 0;
+		pid_t result;
+		while((result = waitpid(child, &status, 0)) < 0 && errno == EINTR)
+		{
+			// Interrupted by a signal, pass it on
+			kill(child, SIGTERM);
+		}
+
+		if(result < 0
+			|| !WIFEXITED(status)
+			|| WEXITSTATUS(status) != EXIT_SUCCESS)
+		{
+			exitCode = EXIT_FAILURE;
+		}
+	}
+
+	return exitCode;
+}
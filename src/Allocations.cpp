@@ -0,0 +1,79 @@
+#include "Allocations.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Plain integers so they need no construction, operator new can run before
+// anything else
+thread_local uint64_t tNumAllocations = 0;
+thread_local uint64_t tAllocatedBytes = 0;
+
+void* allocate(std::size_t size)
+{
+	++tNumAllocations;
+	tAllocatedBytes += size;
+	return malloc(size > 0 ? size : 1);
+}
+
+}
+
+uint64_t AllocationCounter::getThreadAllocations()
+{
+	return tNumAllocations;
+}
+
+uint64_t AllocationCounter::getThreadAllocatedBytes()
+{
+	return tAllocatedBytes;
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+	void* ptr = xveearr::allocate(size);
+	if(ptr == NULL) { throw std::bad_alloc(); }
+	return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+	void* ptr = xveearr::allocate(size);
+	if(ptr == NULL) { throw std::bad_alloc(); }
+	return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return xveearr::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return xveearr::allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
@@ -0,0 +1,22 @@
+#ifndef XVEEARR_ALLOCATIONS_HPP
+#define XVEEARR_ALLOCATIONS_HPP
+
+#include <cstdint>
+
+namespace xveearr
+{
+
+// Counts heap allocations made through operator new, per thread. Linking
+// Allocations.cpp replaces the global operator new. malloc calls from C
+// libraries and bgfx's allocator are not seen.
+class AllocationCounter
+{
+public:
+	// Made by the calling thread since it started
+	static uint64_t getThreadAllocations();
+	static uint64_t getThreadAllocatedBytes();
+};
+
+}
+
+#endif
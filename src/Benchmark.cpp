@@ -0,0 +1,263 @@
+#include "Benchmark.hpp"
+#include <cstdio>
+#include <algorithm>
+#include <iomanip>
+#include <bx/bx.h>
+#include <bx/platform.h>
+#include <bx/timer.h>
+#include "Profiler.hpp"
+#include "Log.hpp"
+
+#if BX_PLATFORM_LINUX == 1
+#	include <sys/resource.h>
+#endif
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Frame times are reserved for this rate over the whole run so the vector
+// never grows while measuring, even without vsync and with the null
+// renderer. 8 bytes per frame, 4.8 MB for a minute.
+static const double gMaxFrameRate = 10000.0;
+// Containers reach their working size and one-time resources are created
+static const size_t gWarmUpFrames = 60;
+
+static int64_t getPercentile(const std::vector<int64_t>& sorted, double p)
+{
+	if(sorted.empty()) { return 0; }
+
+	// Nearest rank
+	size_t rank = (size_t)(p * (double)sorted.size() + 0.5);
+	return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+// In kilobytes, 0 when unknown
+static long getPeakRSS()
+{
+#if BX_PLATFORM_LINUX == 1
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0) { return usage.ru_maxrss; }
+#endif
+	return 0;
+}
+
+}
+
+Benchmark::Benchmark()
+	:mEnabled(false)
+	,mDuration(0)
+	,mStartTime(0)
+	,mLastFrame(0)
+	,mNumDrawCalls(0)
+	,mZeroAllocations(false)
+	,mMainAllocations(0)
+	,mRenderAllocations(0)
+	,mWorkerAllocations(0)
+	,mNumAllocatingFrames(0)
+	,mRendererCpuTime(0.0)
+	,mRendererGpuTime(0.0)
+	,mNumGpuSamples(0)
+{}
+
+void Benchmark::init(double duration, bool zeroAllocations)
+{
+	mEnabled = true;
+	mZeroAllocations = zeroAllocations;
+	mDuration = (int64_t)(duration * (double)bx::getHPFrequency());
+}
+
+void Benchmark::start(int64_t now)
+{
+	mStartTime = now;
+	mLastFrame = 0;
+	mFrameTimes.clear();
+	mFrameTimes.reserve(
+		(size_t)((double)mDuration / (double)bx::getHPFrequency() * gMaxFrameRate)
+	);
+	mStageTimes.clear();
+	mStageCalls.clear();
+	mNumDrawCalls = 0;
+	mMainAllocations = 0;
+	mRenderAllocations = 0;
+	mWorkerAllocations = 0;
+	mNumAllocatingFrames = 0;
+	mRendererCpuTime = 0.0;
+	mRendererGpuTime = 0.0;
+	mNumGpuSamples = 0;
+}
+
+bool Benchmark::isEnabled() const
+{
+	return mEnabled;
+}
+
+bool Benchmark::isFinished(int64_t now) const
+{
+	return mEnabled && now - mStartTime >= mDuration;
+}
+
+void Benchmark::addDrawCalls(unsigned int numDrawCalls)
+{
+	mNumDrawCalls += numDrawCalls;
+}
+
+void Benchmark::addAllocations(
+	uint64_t mainThread, uint64_t renderThread, uint64_t workerThreads
+)
+{
+	mMainAllocations += mainThread;
+	mRenderAllocations += renderThread;
+	mWorkerAllocations += workerThreads;
+	if(mFrameTimes.size() >= gWarmUpFrames
+		&& mainThread + renderThread + workerThreads > 0)
+	{
+		++mNumAllocatingFrames;
+	}
+}
+
+void Benchmark::frameSubmitted(int64_t now, double cpuTime, double gpuTime)
+{
+	// The first frame only marks the start of the first interval
+	if(mLastFrame != 0) { mFrameTimes.push_back(now - mLastFrame); }
+	mLastFrame = now;
+
+	unsigned int numMarkers = Profiler::getNumMarkers();
+	mStageTimes.resize(numMarkers, 0);
+	mStageCalls.resize(numMarkers, 0);
+	for(unsigned int i = 0; i < numMarkers; ++i)
+	{
+		mStageTimes[i] += Profiler::getLastTime(i);
+		mStageCalls[i] += Profiler::getLastCalls(i);
+	}
+
+	mRendererCpuTime += cpuTime;
+	if(gpuTime > 0.0)
+	{
+		mRendererGpuTime += gpuTime;
+		++mNumGpuSamples;
+	}
+}
+
+bool Benchmark::report(const char* jsonPath)
+{
+	double toMs = 1000.0 / (double)bx::getHPFrequency();
+	size_t numFrames = mFrameTimes.size();
+	// Per-frame averages include the first frame which has no interval
+	double numSubmitted = (double)(numFrames + (mLastFrame != 0 ? 1 : 0));
+	double perFrame = numSubmitted > 0.0 ? 1.0 / numSubmitted : 0.0;
+
+	std::vector<int64_t> sorted(mFrameTimes);
+	std::sort(sorted.begin(), sorted.end());
+	int64_t total = 0;
+	for(int64_t frameTime: sorted) { total += frameTime; }
+
+	double elapsed = (double)(mLastFrame - mStartTime) * toMs / 1000.0;
+	double mean = numFrames > 0 ? (double)total * toMs / (double)numFrames : 0.0;
+	double p50 = (double)getPercentile(sorted, 0.50) * toMs;
+	double p95 = (double)getPercentile(sorted, 0.95) * toMs;
+	double p99 = (double)getPercentile(sorted, 0.99) * toMs;
+	double max = sorted.empty() ? 0.0 : (double)sorted.back() * toMs;
+	double fps = mean > 0.0 ? 1000.0 / mean : 0.0;
+	double drawCalls = (double)mNumDrawCalls * perFrame;
+	double rendererCpu = mRendererCpuTime * 1000.0 * perFrame;
+	double rendererGpu = mNumGpuSamples > 0
+		? mRendererGpuTime * 1000.0 / (double)mNumGpuSamples
+		: 0.0;
+	double mainAllocations = (double)mMainAllocations * perFrame;
+	double renderAllocations = (double)mRenderAllocations * perFrame;
+	double workerAllocations = (double)mWorkerAllocations * perFrame;
+	long peakRSS = getPeakRSS();
+
+	XVR_LOG(Info,
+		"Benchmark: ", numFrames, " frame(s) in ",
+		std::fixed, std::setprecision(2), elapsed, " s (",
+		fps, " fps)"
+	);
+	XVR_LOG(Info,
+		"  frame time      ", std::fixed, std::setprecision(3),
+		"mean ", mean, " ms, p50 ", p50, " ms, p95 ", p95,
+		" ms, p99 ", p99, " ms, max ", max, " ms"
+	);
+	for(unsigned int i = 0; i < mStageTimes.size(); ++i)
+	{
+		XVR_LOG(Info,
+			"  ", std::left, std::setw(16), Profiler::getMarkerName(i),
+			std::right, std::fixed, std::setprecision(3),
+			std::setw(9), (double)mStageTimes[i] * toMs * perFrame, " ms/frame",
+			std::setprecision(1), std::setw(9),
+			(double)mStageCalls[i] * perFrame, " calls/frame"
+		);
+	}
+	XVR_LOG(Info,
+		"  draw calls      ", std::fixed, std::setprecision(1), drawCalls, "/frame"
+	);
+	XVR_LOG(Info,
+		"  renderer        ", std::fixed, std::setprecision(3),
+		"cpu ", rendererCpu, " ms/frame, gpu ",
+		rendererGpu, " ms/frame"
+	);
+	XVR_LOG(Info,
+		"  allocations     ", std::fixed, std::setprecision(2),
+		"main ", mainAllocations, "/frame, render ", renderAllocations,
+		"/frame, workers ", workerAllocations,
+		"/frame, ", mNumAllocatingFrames, " allocating frame(s) after warm up"
+	);
+	XVR_LOG(Info, "  peak RSS        ", peakRSS, " KiB");
+
+	FILE* file = jsonPath ? fopen(jsonPath, "w") : stdout;
+	XVR_ENSURE(file != NULL, "Could not open ", jsonPath, " for writing");
+
+	fprintf(file,
+		"{\"duration_s\":%.3f,\"frames\":%zu,\"fps\":%.2f,"
+		"\"frame_time_ms\":{\"mean\":%.3f,\"p50\":%.3f,\"p95\":%.3f,"
+		"\"p99\":%.3f,\"max\":%.3f},\"stage_ms\":{",
+		elapsed, numFrames, fps, mean, p50, p95, p99, max
+	);
+	for(unsigned int i = 0; i < mStageTimes.size(); ++i)
+	{
+		fprintf(file, "%s\"%s\":%.3f",
+			i > 0 ? "," : "",
+			Profiler::getMarkerName(i),
+			(double)mStageTimes[i] * toMs * perFrame
+		);
+	}
+	fprintf(file, "},\"stage_calls_per_frame\":{");
+	for(unsigned int i = 0; i < mStageCalls.size(); ++i)
+	{
+		fprintf(file, "%s\"%s\":%.2f",
+			i > 0 ? "," : "",
+			Profiler::getMarkerName(i),
+			(double)mStageCalls[i] * perFrame
+		);
+	}
+	fprintf(file,
+		"},\"draw_calls_per_frame\":%.1f,\"renderer_cpu_ms\":%.3f,"
+		"\"renderer_gpu_ms\":%.3f,\"allocations_per_frame\":{\"main\":%.2f,"
+		"\"render\":%.2f,\"workers\":%.2f},\"allocating_frames\":%u,"
+		"\"peak_rss_kb\":%ld}\n",
+		drawCalls, rendererCpu, rendererGpu, mainAllocations, renderAllocations,
+		workerAllocations, mNumAllocatingFrames, peakRSS
+	);
+
+	if(file == stdout)
+	{
+		fflush(file);
+	}
+	else
+	{
+		fclose(file);
+		XVR_LOG(Info, "Benchmark results written to ", jsonPath);
+	}
+
+	XVR_ENSURE(
+		!mZeroAllocations || mNumAllocatingFrames == 0,
+		mNumAllocatingFrames, " frame(s) allocated after warm up"
+	);
+
+	return true;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef XVEEARR_BENCHMARK_HPP
+#define XVEEARR_BENCHMARK_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace xveearr
+{
+
+// Collects per-frame timings for --bench and reports them once the run is
+// over. Stage times come from the profiler's markers. Times are in
+// bx::getHPCounter ticks.
+class Benchmark
+{
+public:
+	Benchmark();
+
+	// With zeroAllocations, the run fails when a frame past the warm up
+	// allocated on the main, render or worker threads
+	void init(double duration, bool zeroAllocations);
+	// Right before the first frame
+	void start(int64_t now);
+	bool isEnabled() const;
+	bool isFinished(int64_t now) const;
+
+	void addDrawCalls(unsigned int numDrawCalls);
+	// Heap allocations made by each thread for the frame, workers summed
+	void addAllocations(
+		uint64_t mainThread, uint64_t renderThread, uint64_t workerThreads
+	);
+	// After bgfx::frame and Profiler::endFrame. Renderer times are in
+	// seconds, 0 when unknown.
+	void frameSubmitted(int64_t now, double cpuTime, double gpuTime);
+
+	// Human readable summary to the log, JSON to the given file or stdout
+	// when it is NULL
+	bool report(const char* jsonPath);
+
+private:
+	bool mEnabled;
+	int64_t mDuration;
+	int64_t mStartTime;
+	int64_t mLastFrame;
+	std::vector<int64_t> mFrameTimes;
+	// Per profiler marker
+	std::vector<int64_t> mStageTimes;
+	std::vector<uint64_t> mStageCalls;
+	uint64_t mNumDrawCalls;
+	bool mZeroAllocations;
+	uint64_t mMainAllocations;
+	uint64_t mRenderAllocations;
+	uint64_t mWorkerAllocations;
+	unsigned int mNumAllocatingFrames;
+	double mRendererCpuTime;
+	double mRendererGpuTime;
+	unsigned int mNumGpuSamples;
+};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "DesktopSpace.hpp"
+#include <bx/fpumath.h>
+#include "WindowGroups.hpp"
+
+namespace xveearr
+{
+
+DesktopSpace::DesktopSpace()
+	:mHalfScreenWidth(0.f)
+	,mHalfScreenHeight(0.f)
+	,mXPixelsToMeters(0.f)
+	,mYPixelsToMeters(0.f)
+{}
+
+void DesktopSpace::init(const DisplayMetrics& metrics)
+{
+	mHalfScreenWidth = metrics.mWidthInMeters * 0.5f;
+	mHalfScreenHeight = metrics.mHeightInMeters * 0.5f;
+	mXPixelsToMeters = metrics.mWidthInMeters / (float)metrics.mWidthInPixels;
+	mYPixelsToMeters = metrics.mHeightInMeters / (float)metrics.mHeightInPixels;
+}
+
+float DesktopSpace::getWidthInMeters(float pixels) const
+{
+	return pixels * mXPixelsToMeters;
+}
+
+float DesktopSpace::getHeightInMeters(float pixels) const
+{
+	return pixels * mYPixelsToMeters;
+}
+
+void DesktopSpace::getPixelTransform(
+	float x, float y, float zOrder, float* result
+) const
+{
+	bx::mtxTranslate(result,
+		x * mXPixelsToMeters - mHalfScreenWidth,
+		-(y * mYPixelsToMeters - mHalfScreenHeight),
+		zOrder);
+}
+
+void DesktopSpace::transformPoint(
+	const float* groupTransform, float x, float y, float* result
+) const
+{
+	float pos[] = {
+		x * mXPixelsToMeters - mHalfScreenWidth,
+		-(y * mYPixelsToMeters - mHalfScreenHeight),
+		0.f,
+		1.f
+	};
+	float transformed[4];
+	bx::vec4MulMtx(transformed, pos, groupTransform);
+	result[0] = transformed[0];
+	result[1] = transformed[1];
+	result[2] = transformed[2];
+}
+
+void DesktopSpace::getCursorTransform(
+	const float* groupTransform,
+	int mouseX, int mouseY,
+	const CursorInfo& cursorInfo,
+	float zOrder,
+	float* result
+) const
+{
+	float relTransform[16];
+	getPixelTransform(
+		(float)mouseX - (float)cursorInfo.mOriginX,
+		(float)mouseY - (float)cursorInfo.mOriginY,
+		zOrder,
+		relTransform
+	);
+	bx::mtxMul(result, relTransform, groupTransform);
+}
+
+void DesktopSpace::computeTransforms(DrawItem* items, unsigned int numItems) const
+{
+	for(unsigned int i = 0; i < numItems; ++i)
+	{
+		DrawItem& drawItem = items[i];
+		const WindowInfo& wndInfo = *drawItem.mInfo;
+
+		float relTransform[16];
+		getPixelTransform(
+			(float)wndInfo.mX, (float)wndInfo.mY, drawItem.mZOrder, relTransform
+		);
+		bx::mtxMul(drawItem.mTransform, relTransform, drawItem.mGroup->mTransform);
+	}
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef XVEEARR_DESKTOP_SPACE_HPP
+#define XVEEARR_DESKTOP_SPACE_HPP
+
+#include "IWindowSystem.hpp"
+
+namespace xveearr
+{
+
+struct DrawItem;
+
+// Maps desktop pixels onto the plane of a window group. The plane is
+// centered on the group's origin, 1 unit is 1 meter and y points up.
+class DesktopSpace
+{
+public:
+	DesktopSpace();
+
+	void init(const DisplayMetrics& metrics);
+
+	float getWidthInMeters(float pixels) const;
+	float getHeightInMeters(float pixels) const;
+
+	// Transform of a desktop pixel relative to its group
+	void getPixelTransform(float x, float y, float zOrder, float* result) const;
+	// A desktop pixel in world space
+	void transformPoint(
+		const float* groupTransform, float x, float y, float* result
+	) const;
+	// World transform of the cursor's top left corner when it is over the
+	// given group
+	void getCursorTransform(
+		const float* groupTransform,
+		int mouseX, int mouseY,
+		const CursorInfo& cursorInfo,
+		float zOrder,
+		float* result
+	) const;
+	// Fills in the world transforms of draw items
+	void computeTransforms(DrawItem* items, unsigned int numItems) const;
+
+private:
+	float mHalfScreenWidth;
+	float mHalfScreenHeight;
+	float mXPixelsToMeters;
+	float mYPixelsToMeters;
+};
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "DynamicResolution.hpp"
+#include <bx/bx.h>
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const float gScales[] = { 1.f, 0.9f, 0.8f, 0.7f, 0.6f, 0.5f };
+// Fractions of the frame time budget
+static const double gHighLoad = 0.9;
+static const double gLowLoad = 0.75;
+// Frames averaged before deciding
+static const unsigned int gMinSamples = 10;
+// GPU times lag behind submission, ignore the frames still rendered at the
+// old scale after a change
+static const unsigned int gCooldownFrames = 4;
+
+}
+
+DynamicResolution::DynamicResolution()
+	:mEnabled(false)
+	,mTargetFrameTime(0.0)
+	,mAvgFrameTime(0.0)
+	,mNumSamples(0)
+	,mLevel(0)
+	,mCooldown(0)
+{}
+
+void DynamicResolution::init(bool enabled, double targetFrameRate)
+{
+	mEnabled = enabled;
+	mTargetFrameTime = 1.0 / targetFrameRate;
+	mAvgFrameTime = 0.0;
+	mNumSamples = 0;
+	mLevel = 0;
+	mCooldown = 0;
+}
+
+void DynamicResolution::update(double gpuTime)
+{
+	if(!mEnabled || gpuTime <= 0.0) { return; }
+
+	if(mCooldown > 0)
+	{
+		--mCooldown;
+		return;
+	}
+
+	mAvgFrameTime = mNumSamples == 0
+		? gpuTime
+		: mAvgFrameTime * 0.9 + gpuTime * 0.1;
+	if(++mNumSamples < gMinSamples) { return; }
+
+	unsigned int level = mLevel;
+	if(mAvgFrameTime > gHighLoad * mTargetFrameTime)
+	{
+		if(level + 1 < BX_COUNTOF(gScales)) { ++level; }
+	}
+	else if(level > 0)
+	{
+		// Cost grows with the number of pixels
+		double ratio = gScales[level - 1] / gScales[level];
+		double estimate = mAvgFrameTime * ratio * ratio;
+		if(estimate < gLowLoad * mTargetFrameTime) { --level; }
+	}
+
+	if(level == mLevel) { return; }
+
+	XVR_LOG(Debug,
+		"Render scale: ", gScales[mLevel], " -> ", gScales[level],
+		" (GPU time ", mAvgFrameTime * 1000.0, " ms)"
+	);
+	mLevel = level;
+	mNumSamples = 0;
+	mCooldown = gCooldownFrames;
+}
+
+bool DynamicResolution::isEnabled() const
+{
+	return mEnabled;
+}
+
+float DynamicResolution::getScale() const
+{
+	return gScales[mLevel];
+}
+
+}
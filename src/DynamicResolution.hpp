@@ -0,0 +1,34 @@
+#ifndef XVEEARR_DYNAMIC_RESOLUTION_HPP
+#define XVEEARR_DYNAMIC_RESOLUTION_HPP
+
+namespace xveearr
+{
+
+// Lowers the eye buffer render scale in steps when the GPU cannot keep up
+// with the display and raises it again once there is headroom. The eye
+// buffers keep their full size, only a sub-rectangle of them is rendered.
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+
+	void init(bool enabled, double targetFrameRate);
+	// Once per frame at full rate with the GPU time of the last rendered
+	// frame, in seconds. Unknown times (0) are ignored.
+	void update(double gpuTime);
+	bool isEnabled() const;
+	// Fraction of the eye buffer width and height which is rendered
+	float getScale() const;
+
+private:
+	bool mEnabled;
+	double mTargetFrameTime;
+	double mAvgFrameTime;
+	unsigned int mNumSamples;
+	unsigned int mLevel;
+	unsigned int mCooldown;
+};
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "EventBuffer.hpp"
+
+namespace xveearr
+{
+
+void EventBuffer::clear()
+{
+	mEvents.clear();
+}
+
+void EventBuffer::reserve(unsigned int numEvents)
+{
+	mEvents.reserve(numEvents);
+}
+
+void EventBuffer::push(const BufferedEvent& event)
+{
+	switch(event.mType)
+	{
+		case WindowEvent::WindowRemoved:
+			{
+				bool completeCycle = false;
+				for(auto itr = mEvents.begin(); itr != mEvents.end();)
+				{
+					if(itr->mWindow == event.mWindow)
+					{
+						if(itr->mType == WindowEvent::WindowAdded)
+						{
+							completeCycle = true;
+						}
+						itr = mEvents.erase(itr);
+					}
+					else
+					{
+						++itr;
+					}
+				}
+
+				if(!completeCycle) { mEvents.push_back(event); }
+			}
+			break;
+		case WindowEvent::WindowUpdated:
+			{
+				bool coalesced = false;
+				for(BufferedEvent& pastEvent: mEvents)
+				{
+					if(pastEvent.mWindow != event.mWindow) { continue; }
+
+					// Damage events do not carry geometry
+					if(event.mFields & WindowEvent::Position)
+					{
+						pastEvent.mX = event.mX;
+						pastEvent.mY = event.mY;
+						pastEvent.mWidth = event.mWidth;
+						pastEvent.mHeight = event.mHeight;
+					}
+					// Keeps the earlier time, the change is pending since then
+					pastEvent.mFields |= event.mFields;
+					coalesced = true;
+				}
+
+				if(!coalesced) { mEvents.push_back(event); }
+			}
+			break;
+		default:
+			mEvents.push_back(event);
+			break;
+	}
+}
+
+unsigned int EventBuffer::size() const
+{
+	return (unsigned int)mEvents.size();
+}
+
+EventBuffer::const_iterator EventBuffer::begin() const
+{
+	return mEvents.begin();
+}
+
+EventBuffer::const_iterator EventBuffer::end() const
+{
+	return mEvents.end();
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef XVEEARR_EVENT_BUFFER_HPP
+#define XVEEARR_EVENT_BUFFER_HPP
+
+#include <vector>
+#include "IWindowSystem.hpp"
+
+namespace xveearr
+{
+
+struct BufferedEvent
+{
+	WindowEvent::Type mType;
+	WindowId mWindow;
+	int mX;
+	int mY;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	// WindowEvent::Field
+	uint32_t mFields;
+	// bx::getHPCounter ticks when it was read from the window system
+	int64_t mTime;
+};
+
+// Collects raw window system events drained in one go and coalesces them
+// so each window is translated at most once: updates are merged into the
+// window's earlier event and a window added then removed in the same batch
+// is dropped entirely.
+class EventBuffer
+{
+public:
+	typedef std::vector<BufferedEvent>::const_iterator const_iterator;
+
+	void clear();
+	// Avoids growing during the first batches
+	void reserve(unsigned int numEvents);
+	void push(const BufferedEvent& event);
+	unsigned int size() const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+private:
+	std::vector<BufferedEvent> mEvents;
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "EventRecorder.hpp"
+#include <bx/timer.h>
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+EventRecorder::EventRecorder()
+	:mWindowSystem(NULL)
+{}
+
+bool EventRecorder::open(IWindowSystem* windowSystem, const char* path)
+{
+	mWindowSystem = windowSystem;
+	XVR_ENSURE(
+		mWriter.open(path, windowSystem->getDisplayMetrics()),
+		"Could not start recording window events"
+	);
+	XVR_LOG(Info, "Recording ", windowSystem->getName(), " events to ", path);
+
+	return true;
+}
+
+bool EventRecorder::probe()
+{
+	return mWindowSystem->probe();
+}
+
+bool EventRecorder::isSynthetic() const
+{
+	return mWindowSystem->isSynthetic();
+}
+
+bool EventRecorder::init(const WindowSystemCfg& cfg)
+{
+	return mWindowSystem->init(cfg);
+}
+
+void EventRecorder::shutdown()
+{
+	mWriter.close();
+	mWindowSystem->shutdown();
+}
+
+const char* EventRecorder::getName() const
+{
+	return mWindowSystem->getName();
+}
+
+void EventRecorder::initRenderer()
+{
+	mWindowSystem->initRenderer();
+}
+
+void EventRecorder::shutdownRenderer()
+{
+	mWindowSystem->shutdownRenderer();
+}
+
+void EventRecorder::beginRender()
+{
+	mWindowSystem->beginRender();
+}
+
+void EventRecorder::endRender()
+{
+	mWindowSystem->endRender();
+}
+
+DisplayMetrics EventRecorder::getDisplayMetrics()
+{
+	return mWindowSystem->getDisplayMetrics();
+}
+
+unsigned int EventRecorder::pollEvents(
+	WindowEvent* events, unsigned int maxEvents
+)
+{
+	unsigned int numEvents = mWindowSystem->pollEvents(events, maxEvents);
+	mWriter.write(bx::getHPCounter(), events, numEvents);
+
+	return numEvents;
+}
+
+void EventRecorder::waitEvent(unsigned int timeoutMs)
+{
+	mWindowSystem->waitEvent(timeoutMs);
+}
+
+const WindowInfo* EventRecorder::getWindowInfo(WindowId id)
+{
+	return mWindowSystem->getWindowInfo(id);
+}
+
+CursorInfo EventRecorder::getCursorInfo()
+{
+	return mWindowSystem->getCursorInfo();
+}
+
+}
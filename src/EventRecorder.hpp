@@ -0,0 +1,41 @@
+#ifndef XVEEARR_EVENT_RECORDER_HPP
+#define XVEEARR_EVENT_RECORDER_HPP
+
+#include "IWindowSystem.hpp"
+#include "WindowEventLog.hpp"
+
+namespace xveearr
+{
+
+// Passes everything through to an initialized window system and writes
+// the events it returns to a file which the "replay" window system reads
+class EventRecorder: public IWindowSystem
+{
+public:
+	EventRecorder();
+
+	bool open(IWindowSystem* windowSystem, const char* path);
+
+	bool probe();
+	bool isSynthetic() const;
+	bool init(const WindowSystemCfg& cfg);
+	void shutdown();
+	const char* getName() const;
+	void initRenderer();
+	void shutdownRenderer();
+	void beginRender();
+	void endRender();
+	DisplayMetrics getDisplayMetrics();
+	unsigned int pollEvents(WindowEvent* events, unsigned int maxEvents);
+	void waitEvent(unsigned int timeoutMs);
+	const WindowInfo* getWindowInfo(WindowId id);
+	CursorInfo getCursorInfo();
+
+private:
+	IWindowSystem* mWindowSystem;
+	WindowEventWriter mWriter;
+};
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "FrameScheduler.hpp"
+#include <algorithm>
+#include <bx/timer.h>
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+// How long the full rate is kept after the last motion (in seconds)
+static const double gMotionHoldTime = 0.5;
+// How long the reduced rate is kept after the last content update
+static const double gContentHoldTime = 1.0;
+static const double gReducedFrameRate = 15.0;
+// Upper bound for blocking in idle mode so HMDs that are not driven by
+// window system events are still polled
+static const unsigned int gIdleWaitTime = 500;
+// Assumed until frames have been measured
+static const double gDefaultFrameRate = 60.0;
+// A frame is rendered during the next bgfx frame and shown at the vsync
+// after that
+static const int64_t gPredictedFrames = 2;
+
+static const char* gModeNames[] = {
+	"full",
+	"reduced",
+	"idle"
+};
+
+}
+
+FrameScheduler::FrameScheduler()
+	:mAdaptive(true)
+	,mMode(Mode::Full)
+	,mFrequency(1)
+	,mLastMotion(0)
+	,mLastContent(0)
+	,mContentInterval(0)
+	,mLastFrame(0)
+	,mRateWindowStart(0)
+	,mRateWindowFrames(0)
+	,mFrameRate(0.f)
+	,mFrameInterval(0)
+{}
+
+void FrameScheduler::init(int64_t now, bool adaptive)
+{
+	mAdaptive = adaptive;
+	mMode = Mode::Full;
+	mFrequency = bx::getHPFrequency();
+	mLastMotion = now;
+	mLastContent = now;
+	mContentInterval = (int64_t)(gContentHoldTime * mFrequency);
+	mLastFrame = now;
+	mRateWindowStart = now;
+	mRateWindowFrames = 0;
+	mFrameRate = 0.f;
+	mFrameInterval.store(
+		(int64_t)(mFrequency / gDefaultFrameRate), std::memory_order_relaxed
+	);
+}
+
+void FrameScheduler::notifyMotion(int64_t now)
+{
+	mLastMotion = now;
+}
+
+void FrameScheduler::notifyContent(int64_t now)
+{
+	// Several windows updated at once count as one update
+	if(now <= mLastContent) { return; }
+
+	// A long pause must not hide a burst of updates right after it
+	int64_t interval = std::min(
+		now - mLastContent, (int64_t)(gContentHoldTime * mFrequency)
+	);
+	mContentInterval = (mContentInterval * 3 + interval) / 4;
+	mLastContent = now;
+}
+
+FrameScheduler::Mode::Enum FrameScheduler::update(int64_t now)
+{
+	Mode::Enum mode;
+	if(!mAdaptive || now - mLastMotion < gMotionHoldTime * mFrequency)
+	{
+		mode = Mode::Full;
+	}
+	else if(now - mLastContent < gContentHoldTime * mFrequency)
+	{
+		// Video or games update constantly, the reduced rate would cap
+		// them. Stops as soon as updates pause for a few reduced frames.
+		bool fastContent =
+			mContentInterval * gReducedFrameRate < mFrequency
+			&& (now - mLastContent) * gReducedFrameRate < 2 * mFrequency;
+		mode = fastContent ? Mode::Full : Mode::Reduced;
+	}
+	else
+	{
+		mode = Mode::Idle;
+	}
+
+	if(mode != mMode)
+	{
+		XVR_LOG(Debug,
+			"Frame rate mode: ", gModeNames[mMode], " -> ", gModeNames[mode]
+		);
+		mMode = mode;
+	}
+
+	return mode;
+}
+
+bool FrameScheduler::shouldRender(int64_t now) const
+{
+	switch(mMode)
+	{
+		case Mode::Full:
+			return true;
+		case Mode::Reduced:
+			return now - mLastFrame >= mFrequency / gReducedFrameRate;
+		default:
+			return false;
+	}
+}
+
+unsigned int FrameScheduler::getWaitTime(int64_t now) const
+{
+	switch(mMode)
+	{
+		case Mode::Reduced:
+			{
+				int64_t nextFrame =
+					mLastFrame + (int64_t)(mFrequency / gReducedFrameRate);
+				// Round up so the loop does not spin until the deadline
+				int64_t waitTime =
+					((nextFrame - now) * 1000 + mFrequency - 1) / mFrequency;
+				return waitTime > 0 ? (unsigned int)waitTime : 0;
+			}
+		case Mode::Idle:
+			return gIdleWaitTime;
+		default:
+			return 0;
+	}
+}
+
+void FrameScheduler::frameSubmitted(int64_t now)
+{
+	// Gaps in reduced and idle mode, or right after them, say nothing
+	// about the display rate
+	int64_t frameInterval = mFrameInterval.load(std::memory_order_relaxed);
+	int64_t interval = now - mLastFrame;
+	if(mMode == Mode::Full && interval < frameInterval * 2)
+	{
+		mFrameInterval.store(
+			(frameInterval * 7 + interval) / 8, std::memory_order_relaxed
+		);
+	}
+	mLastFrame = now;
+	++mRateWindowFrames;
+
+	int64_t windowLength = now - mRateWindowStart;
+	if(windowLength >= mFrequency)
+	{
+		mFrameRate = (float)((double)mRateWindowFrames * mFrequency / windowLength);
+		mRateWindowStart = now;
+		mRateWindowFrames = 0;
+	}
+}
+
+FrameScheduler::Mode::Enum FrameScheduler::getMode() const
+{
+	return mMode;
+}
+
+float FrameScheduler::getFrameRate() const
+{
+	int64_t now = bx::getHPCounter();
+	// Nothing was rendered for a while
+	if(now - mLastFrame > mFrequency) { return 0.f; }
+
+	return mFrameRate;
+}
+
+int64_t FrameScheduler::getFrameInterval() const
+{
+	return mFrameInterval.load(std::memory_order_relaxed);
+}
+
+int64_t FrameScheduler::getDisplayTime(int64_t now) const
+{
+	return now + gPredictedFrames * getFrameInterval();
+}
+
+const char* FrameScheduler::getModeName(Mode::Enum mode)
+{
+	return gModeNames[mode];
+}
+
+}
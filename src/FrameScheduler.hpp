@@ -0,0 +1,75 @@
+#ifndef XVEEARR_FRAME_SCHEDULER_HPP
+#define XVEEARR_FRAME_SCHEDULER_HPP
+
+#include <cstdint>
+#include <atomic>
+
+namespace xveearr
+{
+
+// Decides when the main loop should build a frame. Times are in
+// bx::getHPCounter ticks.
+class FrameScheduler
+{
+public:
+	struct Mode
+	{
+		enum Enum
+		{
+			// Head or scene is moving, or window contents change faster
+			// than the reduced rate, render every vsync
+			Full,
+			// Only window contents are changing, and rarely, render at a
+			// low rate
+			Reduced,
+			// Nothing is changing, block until something happens
+			Idle,
+
+			Count
+		};
+	};
+
+	FrameScheduler();
+
+	void init(int64_t now, bool adaptive);
+
+	// Head motion, input or window geometry changes
+	void notifyMotion(int64_t now);
+	// Window contents changed
+	void notifyContent(int64_t now);
+
+	Mode::Enum update(int64_t now);
+	bool shouldRender(int64_t now) const;
+	// How long the main loop can block waiting for events (in milliseconds)
+	unsigned int getWaitTime(int64_t now) const;
+	void frameSubmitted(int64_t now);
+
+	Mode::Enum getMode() const;
+	float getFrameRate() const;
+	// Smoothed time between frames at full rate, the display's refresh
+	// interval with vsync. Can be called from any thread.
+	int64_t getFrameInterval() const;
+	// When a frame submitted or latched now is shown. Can be called from
+	// any thread.
+	int64_t getDisplayTime(int64_t now) const;
+
+	static const char* getModeName(Mode::Enum mode);
+
+private:
+	bool mAdaptive;
+	Mode::Enum mMode;
+	int64_t mFrequency;
+	int64_t mLastMotion;
+	int64_t mLastContent;
+	// Smoothed time between content updates
+	int64_t mContentInterval;
+	int64_t mLastFrame;
+	int64_t mRateWindowStart;
+	unsigned int mRateWindowFrames;
+	float mFrameRate;
+	std::atomic<int64_t> mFrameInterval;
+};
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "GpuTimer.hpp"
+#include <cstdio>
+#include <cstring>
+#include <bx/platform.h>
+#include <bx/timer.h>
+#include "Profiler.hpp"
+#include "Log.hpp"
+
+#if BX_PLATFORM_LINUX == 1
+#	include <GL/gl.h>
+#	include <GL/glext.h>
+#	include <GL/glx.h>
+#endif
+
+namespace xveearr
+{
+
+namespace
+{
+
+#if BX_PLATFORM_LINUX == 1
+
+struct GLProcs
+{
+	PFNGLGENQUERIESPROC mGenQueries;
+	PFNGLQUERYCOUNTERPROC mQueryCounter;
+	PFNGLGETQUERYOBJECTIVPROC mGetQueryObjectiv;
+	PFNGLGETQUERYOBJECTUI64VPROC mGetQueryObjectui64v;
+};
+
+// Only touched by the render thread
+static GLProcs gGL;
+static bool gLoaded = false;
+static bool gSupported = false;
+
+template<typename T>
+static bool loadProc(T& proc, const char* name)
+{
+	proc = (T)glXGetProcAddress((const GLubyte*)name);
+	return proc != NULL;
+}
+
+static bool loadProcs()
+{
+	if(gLoaded) { return gSupported; }
+
+	// Core since 3.3, llvmpipe also exposes it on older contexts
+	int major = 0;
+	int minor = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if(version) { sscanf(version, "%d.%d", &major, &minor); }
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	bool timerQuery = major * 10 + minor >= 33
+		|| (extensions && strstr(extensions, "GL_ARB_timer_query"));
+	gSupported = timerQuery
+		&& loadProc(gGL.mGenQueries, "glGenQueries")
+		&& loadProc(gGL.mQueryCounter, "glQueryCounter")
+		&& loadProc(gGL.mGetQueryObjectiv, "glGetQueryObjectiv")
+		&& loadProc(gGL.mGetQueryObjectui64v, "glGetQueryObjectui64v");
+	if(!gSupported) { XVR_LOG(Warn, "GPU timing requires ARB_timer_query"); }
+	gLoaded = true;
+
+	return gSupported;
+}
+
+#endif
+
+}
+
+GpuTimer::GpuTimer(const char* name)
+	:mName(name)
+	,mMarker(Profiler::registerMarker(name))
+	,mReady(false)
+	,mFailed(false)
+	,mActive(false)
+	,mFirst(0)
+	,mNumPending(0)
+{
+}
+
+void GpuTimer::begin()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(!prepare()) { return; }
+
+	collect();
+	// The GPU is too far behind, skip this measurement
+	if(mNumPending == MaxPending) { return; }
+
+	unsigned int slot = (mFirst + mNumPending) % MaxPending;
+	gGL.mQueryCounter(mQueries[slot * 2], GL_TIMESTAMP);
+	mActive = true;
+#endif
+}
+
+void GpuTimer::end()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(!mActive) { return; }
+
+	unsigned int slot = (mFirst + mNumPending) % MaxPending;
+	gGL.mQueryCounter(mQueries[slot * 2 + 1], GL_TIMESTAMP);
+	++mNumPending;
+	mActive = false;
+#endif
+}
+
+void GpuTimer::shutdownRenderer()
+{
+	// The queries went away with bgfx's context
+	mReady = false;
+	mActive = false;
+	mFirst = 0;
+	mNumPending = 0;
+}
+
+bool GpuTimer::prepare()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(mReady) { return true; }
+	if(mFailed || glXGetCurrentContext() == NULL) { return false; }
+
+	mFailed = !loadProcs();
+	if(mFailed) { return false; }
+
+	gGL.mGenQueries(MaxPending * 2, mQueries);
+	mReady = true;
+	XVR_LOG(Debug, "GPU timer ", mName, " ready");
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void GpuTimer::collect()
+{
+#if BX_PLATFORM_LINUX == 1
+	double toTicks = (double)bx::getHPFrequency() / 1000000000.0;
+	while(mNumPending > 0)
+	{
+		// Queries complete in order so the end query tells for both
+		GLint available = 0;
+		gGL.mGetQueryObjectiv(
+			mQueries[mFirst * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available
+		);
+		if(!available) { break; }
+
+		GLuint64 beginTime, endTime;
+		gGL.mGetQueryObjectui64v(mQueries[mFirst * 2], GL_QUERY_RESULT, &beginTime);
+		gGL.mGetQueryObjectui64v(mQueries[mFirst * 2 + 1], GL_QUERY_RESULT, &endTime);
+		if(endTime > beginTime)
+		{
+			Profiler::addTime(mMarker, (int64_t)((endTime - beginTime) * toTicks));
+		}
+
+		mFirst = (mFirst + 1) % MaxPending;
+		--mNumPending;
+	}
+#endif
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef XVEEARR_GPU_TIMER_HPP
+#define XVEEARR_GPU_TIMER_HPP
+
+#include <cstdint>
+
+namespace xveearr
+{
+
+// GPU time spent between begin and end on the render thread, measured with
+// GL timestamp queries. Results are read a few frames later, without
+// stalling, and added to the profiler marker of the same name. Does nothing
+// when timer queries are unsupported or no GL context is current.
+class GpuTimer
+{
+public:
+	explicit GpuTimer(const char* name);
+
+	// Render thread, begin and end must be paired
+	void begin();
+	void end();
+	// Once bgfx's context is gone, pending results are lost
+	void shutdownRenderer();
+
+private:
+	static const unsigned int MaxPending = 4;
+
+	bool prepare();
+	void collect();
+
+	const char* mName;
+	unsigned int mMarker;
+	bool mReady;
+	bool mFailed;
+	bool mActive;
+	// Begin and end query of every pending measurement, oldest at mFirst
+	uint32_t mQueries[MaxPending * 2];
+	unsigned int mFirst;
+	unsigned int mNumPending;
+};
+
+}
+
+#endif
@@ -1,13 +1,33 @@
 #ifndef XVEEARR_HMD_HPP
 #define XVEEARR_HMD_HPP
 
+#include <cstdint>
 #include <bgfx/bgfx.h>
 #include "IComponent.hpp"
 #include "IRenderHook.hpp"
 
+namespace bx
+{
+
+class CommandLine;
+
+}
+
 namespace xveearr
 {
 
+struct HMDCfg
+{
+	// Driver specific options, only valid during init
+	const bx::CommandLine* mCmdLine;
+	// Size of each eye buffer, 0 keeps the HMD's own
+	unsigned int mEyeWidth;
+	unsigned int mEyeHeight;
+	// TextureFormat::Count keeps the HMD's own
+	bgfx::TextureFormat::Enum mColorFormat;
+	bgfx::TextureFormat::Enum mDepthFormat;
+};
+
 struct RenderData
 {
 	bgfx::FrameBufferHandle mFrameBuffer;
@@ -15,6 +35,17 @@ struct RenderData
 	float mViewProjection[16];
 };
 
+struct HeadPose
+{
+	float mTransform[16];
+	// Axis scaled by radians per second, in world space
+	float mAngularVelocity[3];
+	// Meters per second, in world space
+	float mLinearVelocity[3];
+	// When the pose was sampled, in bx::getHPCounter ticks
+	int64_t mTimestamp;
+};
+
 struct Eye
 {
 	enum Enum
@@ -26,14 +57,31 @@ struct Eye
 	};
 };
 
-class IHMD: public IComponent<void>, public IRenderHook
+class IHMD: public IComponent<HMDCfg>, public IRenderHook
 {
 public:
 	virtual void prepareResources() = 0;
 	virtual void releaseResources() = 0;
 	virtual void getViewportSize(unsigned int& width, unsigned int& height) = 0;
 	virtual void getHeadTransform(float* heaadTransform) = 0;
+	// The pose sampled by the last update. Can be called from any thread.
+	virtual void getHeadPose(HeadPose& pose) = 0;
+	// Head transform extrapolated to targetTime (bx::getHPCounter ticks).
+	// Can be called from any thread.
+	virtual void getPredictedHeadTransform(
+		int64_t targetTime, float* headTransform
+	) = 0;
+	// View transform of an eye for an arbitrary head transform
+	virtual void getViewTransform(
+		Eye::Enum eye, const float* headTransform, float* viewTransform
+	) = 0;
+	// Main thread, right before update is scheduled on a worker. Input
+	// APIs such as SDL must only be called here.
+	virtual void pollInput() = 0;
 	virtual void update() = 0;
+	// Motion is replayed frame by frame. Predicting or latching it from
+	// wall-clock time would make runs differ.
+	virtual bool isReplay() const = 0;
 	virtual const RenderData& getRenderData(Eye::Enum eye) = 0;
 };
 
@@ -2,12 +2,20 @@
 #define XVEEARR_WINDOW_SYSTEM_HPP
 
 #include <cstdint>
+#include <unordered_map>
 #include <bgfx/bgfx.h>
 #include "IComponent.hpp"
 #include "IRenderHook.hpp"
 
 struct SDL_Window;
 
+namespace bx
+{
+
+class CommandLine;
+
+}
+
 namespace xveearr
 {
 
@@ -25,6 +33,10 @@ struct WindowInfo
 	unsigned int mHeight;
 };
 
+// Authoritative window table. It is owned by the window manager and written
+// by the window system, events only tell which entries changed.
+typedef std::unordered_map<WindowId, WindowInfo> WindowTable;
+
 struct CursorInfo
 {
 	bgfx::TextureHandle mTexture;
@@ -45,9 +57,29 @@ struct WindowEvent
 		Count
 	};
 
-	Type mType;
+	enum Field
+	{
+		Position = 1 << 0,
+		Size = 1 << 1,
+		Texture = 1 << 2,
+		Content = 1 << 3
+	};
+
 	WindowId mWindow;
-	WindowInfo mInfo;
+	// The table entry is already gone when a window is removed so its group
+	// has to travel with the event
+	PID mPID;
+	Type mType;
+	uint32_t mChangedFields;
+	// bx::getHPCounter ticks when the window system received the event
+	int64_t mTime;
+	// Geometry right after the event, the table only holds the state after
+	// the whole batch. Zero for removed windows.
+	int mX;
+	int mY;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	bool mInvertedY;
 };
 
 struct DisplayMetrics
@@ -61,13 +93,28 @@ struct DisplayMetrics
 struct WindowSystemCfg
 {
 	SDL_Window* mWindow;
+	WindowTable* mWindowTable;
+	// Backend specific options, only valid during init
+	const bx::CommandLine* mCmdLine;
 };
 
 class IWindowSystem: public IComponent<WindowSystemCfg>, public IRenderHook
 {
 public:
+	// Initialization which does not need the SDL window. It runs on a worker
+	// thread while SDL starts, init is only called if it succeeds.
+	virtual bool probe() = 0;
+	// Test backends are only used when chosen by name
+	virtual bool isSynthetic() const = 0;
 	virtual DisplayMetrics getDisplayMetrics() = 0;
-	virtual bool pollEvent(WindowEvent& event) = 0;
+	// Copy up to maxEvents pending events into events and return how many
+	// were copied. Anything left over is returned by the next call.
+	virtual unsigned int pollEvents(
+		WindowEvent* events, unsigned int maxEvents
+	) = 0;
+	// Block until new events may be available or timeoutMs has passed.
+	// Spurious wakeups are allowed.
+	virtual void waitEvent(unsigned int timeoutMs) = 0;
 	virtual const WindowInfo* getWindowInfo(WindowId id) = 0;
 	virtual CursorInfo getCursorInfo() = 0;
 };
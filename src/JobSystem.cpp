@@ -0,0 +1,300 @@
+#include "JobSystem.hpp"
+#include <bx/timer.h>
+#include "Allocations.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const unsigned int gMaxJobs = 1024;
+static const unsigned int gMaxDependents = 4096;
+
+// 0 is shared by every thread which is not a worker
+thread_local unsigned int gWorkerIndex = 0;
+
+}
+
+JobSystem::JobSystem()
+	:mRunning(false)
+	,mNumJobs(0)
+	,mNumStartedWorkers(0)
+	,mNumWorkers(0)
+	,mThreads(NULL)
+	,mQueues(NULL)
+	,mWorkerAllocations(NULL)
+	,mJobs(NULL)
+	,mDependents(NULL)
+	,mNumDependents(0)
+	,mNumWaiters(0)
+{}
+
+bool JobSystem::init(unsigned int numWorkers)
+{
+	mNumWorkers = numWorkers;
+	mJobs = new Job[gMaxJobs];
+	mDependents = new Dependent[gMaxDependents];
+	mQueues = new WorkQueue[numWorkers + 1];
+	for(unsigned int i = 0; i <= numWorkers; ++i)
+	{
+		mQueues[i].mHead = 0;
+		mQueues[i].mTail = 0;
+	}
+	mWorkerAllocations = new std::atomic<uint64_t>[numWorkers];
+	for(unsigned int i = 0; i < numWorkers; ++i) { mWorkerAllocations[i] = 0; }
+	mTimings.reserve(gMaxJobs);
+
+	mRunning = true;
+	mThreads = new bx::Thread[numWorkers];
+	for(unsigned int i = 0; i < numWorkers; ++i)
+	{
+		mThreads[i].init(workerThread, this, 0, "Worker thread");
+	}
+
+	XVR_LOG(Info, "Job system started with ", numWorkers, " worker(s)");
+
+	return true;
+}
+
+void JobSystem::shutdown()
+{
+	mRunning = false;
+	mWorkSem.post(mNumWorkers);
+	for(unsigned int i = 0; i < mNumWorkers; ++i)
+	{
+		if(mThreads[i].isRunning()) { mThreads[i].shutdown(); }
+	}
+
+	delete[] mThreads;
+	delete[] mQueues;
+	delete[] mWorkerAllocations;
+	delete[] mDependents;
+	delete[] mJobs;
+	mThreads = NULL;
+	mQueues = NULL;
+	mWorkerAllocations = NULL;
+	mDependents = NULL;
+	mJobs = NULL;
+	mNumWorkers = 0;
+}
+
+JobSystem::Job* JobSystem::create(const char* name, JobFn fn, void* userData)
+{
+	unsigned int index = mNumJobs.fetch_add(1);
+	if(index >= gMaxJobs)
+	{
+		mNumJobs = gMaxJobs;
+		XVR_LOG(Error, "Too many jobs in a single frame");
+		return NULL;
+	}
+
+	Job* job = &mJobs[index];
+	job->mFn = fn;
+	job->mUserData = userData;
+	job->mName = name;
+	// Released by schedule
+	job->mNumPendings = 1;
+	job->mFinished = false;
+	job->mDependents = NULL;
+	job->mStart = 0;
+	job->mDuration = 0;
+	job->mWorker = 0;
+
+	return job;
+}
+
+void JobSystem::addDependency(Job* job, Job* dependency)
+{
+	if(job == NULL || dependency == NULL) { return; }
+
+	bx::MutexScope lock(mDependencyMutex);
+	if(dependency->mFinished) { return; }
+
+	if(mNumDependents >= gMaxDependents)
+	{
+		XVR_LOG(Error, "Too many job dependencies in a single frame");
+		return;
+	}
+
+	Dependent* dependent = &mDependents[mNumDependents++];
+	dependent->mJob = job;
+	dependent->mNext = dependency->mDependents;
+	dependency->mDependents = dependent;
+	++job->mNumPendings;
+}
+
+void JobSystem::schedule(Job* job)
+{
+	if(job == NULL) { return; }
+
+	if(--job->mNumPendings == 0) { push(job); }
+}
+
+void JobSystem::wait(Job* job)
+{
+	if(job == NULL) { return; }
+
+	unsigned int worker = gWorkerIndex;
+	while(!job->mFinished)
+	{
+		Job* otherJob = findJob(worker);
+		if(otherJob)
+		{
+			execute(otherJob, worker);
+			continue;
+		}
+
+		// The job is running elsewhere. Registering before checking again
+		// means a job finishing in between still posts.
+		++mNumWaiters;
+		if(!job->mFinished) { mFinishSem.wait(); }
+		--mNumWaiters;
+	}
+}
+
+void JobSystem::reset()
+{
+	mNumJobs = 0;
+	mNumDependents = 0;
+}
+
+unsigned int JobSystem::getNumWorkers() const
+{
+	return mNumWorkers;
+}
+
+uint64_t JobSystem::getWorkerAllocations() const
+{
+	uint64_t numAllocations = 0;
+	for(unsigned int i = 0; i < mNumWorkers; ++i)
+	{
+		numAllocations += mWorkerAllocations[i];
+	}
+
+	return numAllocations;
+}
+
+unsigned int JobSystem::getTimings(const JobTiming** timings)
+{
+	mTimings.clear();
+	unsigned int numJobs = mNumJobs;
+	for(unsigned int i = 0; i < numJobs; ++i)
+	{
+		const Job& job = mJobs[i];
+		JobTiming timing;
+		timing.mName = job.mName;
+		timing.mStart = job.mStart;
+		timing.mDuration = job.mDuration;
+		timing.mWorker = job.mWorker;
+		mTimings.push_back(timing);
+	}
+
+	*timings = mTimings.data();
+	return (unsigned int)mTimings.size();
+}
+
+int32_t JobSystem::workerThread(void* userData)
+{
+	JobSystem* jobSystem = static_cast<JobSystem*>(userData);
+	unsigned int worker = ++jobSystem->mNumStartedWorkers;
+	gWorkerIndex = worker;
+	Trace::setThreadName("Worker thread");
+
+	while(jobSystem->mRunning)
+	{
+		Job* job = jobSystem->findJob(worker);
+		if(job)
+		{
+			jobSystem->execute(job, worker);
+		}
+		else
+		{
+			jobSystem->mWorkSem.wait();
+		}
+	}
+
+	return 0;
+}
+
+void JobSystem::push(Job* job)
+{
+	WorkQueue& queue = mQueues[gWorkerIndex];
+	{
+		bx::MutexScope lock(queue.mMutex);
+		queue.mJobs[queue.mTail % BX_COUNTOF(queue.mJobs)] = job;
+		++queue.mTail;
+	}
+
+	mWorkSem.post();
+}
+
+JobSystem::Job* JobSystem::pop(unsigned int worker)
+{
+	WorkQueue& queue = mQueues[worker];
+	bx::MutexScope lock(queue.mMutex);
+	if(queue.mHead == queue.mTail) { return NULL; }
+
+	--queue.mTail;
+	return queue.mJobs[queue.mTail % BX_COUNTOF(queue.mJobs)];
+}
+
+JobSystem::Job* JobSystem::steal(unsigned int worker)
+{
+	WorkQueue& queue = mQueues[worker];
+	bx::MutexScope lock(queue.mMutex);
+	if(queue.mHead == queue.mTail) { return NULL; }
+
+	Job* job = queue.mJobs[queue.mHead % BX_COUNTOF(queue.mJobs)];
+	++queue.mHead;
+	return job;
+}
+
+JobSystem::Job* JobSystem::findJob(unsigned int worker)
+{
+	Job* job = pop(worker);
+	if(job) { return job; }
+
+	for(unsigned int i = 1; i <= mNumWorkers; ++i)
+	{
+		job = steal((worker + i) % (mNumWorkers + 1));
+		if(job) { return job; }
+	}
+
+	return NULL;
+}
+
+void JobSystem::execute(Job* job, unsigned int worker)
+{
+	job->mWorker = worker;
+	job->mStart = bx::getHPCounter();
+	job->mFn(job->mUserData);
+	int64_t end = bx::getHPCounter();
+	job->mDuration = end - job->mStart;
+	if(Trace::isEnabled()) { Trace::addEvent(job->mName, job->mStart, end); }
+	// Before finishing so whoever waits for the job also sees them
+	if(worker > 0)
+	{
+		mWorkerAllocations[worker - 1] = AllocationCounter::getThreadAllocations();
+	}
+
+	Dependent* dependents;
+	{
+		bx::MutexScope lock(mDependencyMutex);
+		dependents = job->mDependents;
+		job->mFinished = true;
+	}
+
+	for(Dependent* itr = dependents; itr != NULL; itr = itr->mNext)
+	{
+		if(--itr->mJob->mNumPendings == 0) { push(itr->mJob); }
+	}
+
+	// Waiters also wake up to run the dependents just pushed
+	unsigned int numWaiters = mNumWaiters;
+	if(numWaiters > 0) { mFinishSem.post(numWaiters); }
+}
+
+}
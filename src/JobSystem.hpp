@@ -0,0 +1,115 @@
+#ifndef XVEEARR_JOB_SYSTEM_HPP
+#define XVEEARR_JOB_SYSTEM_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <bx/bx.h>
+#include <bx/thread.h>
+#include <bx/sem.h>
+#include <bx/mutex.h>
+
+namespace xveearr
+{
+
+typedef void(*JobFn)(void* userData);
+
+struct JobTiming
+{
+	const char* mName;
+	int64_t mStart;
+	int64_t mDuration;
+	unsigned int mWorker;
+};
+
+class JobSystem
+{
+public:
+	struct Job;
+	struct Dependent;
+
+	JobSystem();
+
+	// numWorkers background threads are started, the thread calling wait
+	// also executes jobs
+	bool init(unsigned int numWorkers);
+	void shutdown();
+
+	// Jobs stay valid until the next call to reset. Returns NULL when the
+	// per-frame job pool is exhausted, all other functions ignore NULL jobs.
+	Job* create(const char* name, JobFn fn, void* userData);
+	// job will only start after dependency has finished. Both jobs must be
+	// created in the same frame and job must not be scheduled yet.
+	void addDependency(Job* job, Job* dependency);
+	void schedule(Job* job);
+	// Runs queued jobs meanwhile and sleeps when there are none
+	void wait(Job* job);
+	// Must only be called once every created job has finished
+	void reset();
+
+	unsigned int getNumWorkers() const;
+	// Heap allocations made by the worker threads so far, jobs run by
+	// other threads count towards those threads
+	uint64_t getWorkerAllocations() const;
+	// Timings of all jobs created since the last reset, in bx::getHPCounter
+	// ticks
+	unsigned int getTimings(const JobTiming** timings);
+
+	struct Job
+	{
+		JobFn mFn;
+		void* mUserData;
+		const char* mName;
+		std::atomic<int> mNumPendings;
+		std::atomic<bool> mFinished;
+		Dependent* mDependents;
+		int64_t mStart;
+		int64_t mDuration;
+		unsigned int mWorker;
+	};
+
+	struct Dependent
+	{
+		Job* mJob;
+		Dependent* mNext;
+	};
+
+private:
+	struct WorkQueue
+	{
+		bx::Mutex mMutex;
+		unsigned int mHead;
+		unsigned int mTail;
+		Job* mJobs[1024];
+	};
+
+	static int32_t workerThread(void* userData);
+
+	void push(Job* job);
+	Job* pop(unsigned int worker);
+	Job* steal(unsigned int worker);
+	Job* findJob(unsigned int worker);
+	void execute(Job* job, unsigned int worker);
+
+	std::atomic<bool> mRunning;
+	std::atomic<unsigned int> mNumJobs;
+	std::atomic<unsigned int> mNumStartedWorkers;
+	unsigned int mNumWorkers;
+	bx::Thread* mThreads;
+	WorkQueue* mQueues;
+	// Per worker, published after every job
+	std::atomic<uint64_t>* mWorkerAllocations;
+	Job* mJobs;
+	Dependent* mDependents;
+	unsigned int mNumDependents;
+	bx::Mutex mDependencyMutex;
+	bx::Semaphore mWorkSem;
+	// Threads blocked in wait, woken whenever a job finishes
+	std::atomic<unsigned int> mNumWaiters;
+	bx::Semaphore mFinishSem;
+	std::vector<JobTiming> mTimings;
+};
+
+}
+
+#endif
@@ -0,0 +1,202 @@
+#include "LateLatch.hpp"
+#include <cstring>
+#include <bx/platform.h>
+#include <bx/fpumath.h>
+#include <bx/timer.h>
+#include "IHMD.hpp"
+#include "FrameScheduler.hpp"
+#include "Log.hpp"
+
+#if BX_PLATFORM_LINUX == 1
+#	include <GL/gl.h>
+#	include <GL/glext.h>
+#endif
+
+namespace xveearr
+{
+
+LateLatch::LateLatch()
+	:mHMD(NULL)
+	,mFrameScheduler(NULL)
+	,mEnabled(false)
+	,mResourcesReady(false)
+	,mSubmittedFrame(0)
+	,mTextureFrame(0)
+	,mTexturePending(false)
+	,mRenderedFrames(0)
+	,mTextureRequested(false)
+	,mTextureReady(false)
+	,mGLTexture(0)
+	,mLastUpdate(0)
+{
+	mTexture = BGFX_INVALID_HANDLE;
+	bx::mtxIdentity(mHeadTransform);
+}
+
+void LateLatch::init(IHMD* hmd, const FrameScheduler* frameScheduler)
+{
+	mHMD = hmd;
+	mFrameScheduler = frameScheduler;
+}
+
+void LateLatch::prepareResources()
+{
+#if BX_PLATFORM_LINUX == 1
+	mEnabled = bgfx::getRendererType() == bgfx::RendererType::OpenGL;
+#endif
+	if(!mEnabled)
+	{
+		XVR_LOG(Info, "Late latching requires the OpenGL renderer");
+		return;
+	}
+
+	mTexture = bgfx::createTexture2D(
+		4, 1, 0, bgfx::TextureFormat::RGBA32F,
+		BGFX_TEXTURE_MIN_POINT | BGFX_TEXTURE_MAG_POINT
+		| BGFX_TEXTURE_U_CLAMP | BGFX_TEXTURE_V_CLAMP
+	);
+	// Created by the next submitted frame
+	mTexturePending = true;
+	mResourcesReady = true;
+}
+
+void LateLatch::releaseResources()
+{
+	mResourcesReady = false;
+	mTexturePending = false;
+	mTextureFrame = 0;
+	mFrameSem.post();
+	if(bgfx::isValid(mTexture)) { bgfx::destroyTexture(mTexture); }
+	mTexture = BGFX_INVALID_HANDLE;
+	mEnabled = false;
+}
+
+bool LateLatch::isEnabled() const
+{
+	return mEnabled;
+}
+
+void LateLatch::frameSubmitted(uint32_t frame)
+{
+	if(mTexturePending)
+	{
+		mTextureFrame = frame;
+		mTexturePending = false;
+	}
+
+	mSubmittedFrame = frame;
+	mFrameSem.post();
+}
+
+bgfx::TextureHandle LateLatch::getTexture() const
+{
+	return mTexture;
+}
+
+void LateLatch::getHeadTransform(float* headTransform) const
+{
+	memcpy(headTransform, mHeadTransform, sizeof(mHeadTransform));
+}
+
+void LateLatch::initRenderer()
+{
+}
+
+void LateLatch::shutdownRenderer()
+{
+	// The texture went away with bgfx's context
+	mTextureRequested = false;
+	mTextureReady = false;
+	mGLTexture = 0;
+}
+
+void LateLatch::beginRender()
+{
+	if(!mResourcesReady) { return; }
+
+	// bgfx::renderFrame flips the previous frame and then waits for the
+	// next one, sampling before that would miss the main thread's update.
+	// Posts may outnumber frames so the counter is what tells. Nothing is
+	// known before the main loop's first frame, its texture is not bound
+	// yet anyway.
+	uint32_t nextFrame = mRenderedFrames + 1;
+	while(mResourcesReady
+		&& mSubmittedFrame != 0 && mSubmittedFrame < nextFrame)
+	{
+		mFrameSem.wait();
+	}
+
+	// The texture exists by endRender once its frame is rendered
+	uint32_t textureFrame = mTextureFrame;
+	if(textureFrame != 0 && nextFrame >= textureFrame)
+	{
+		mTextureRequested = true;
+	}
+
+	int64_t now = bx::getHPCounter();
+	mLastUpdate = now;
+
+#if BX_PLATFORM_LINUX == 1
+	if(!mTextureReady) { return; }
+
+	// The frame rendered after beginRender is shown like a submitted one
+	mHMD->getPredictedHeadTransform(
+		mFrameScheduler->getDisplayTime(now), mHeadTransform
+	);
+	float invHeadTransform[16];
+	bx::mtxInverse(invHeadTransform, mHeadTransform);
+
+	glBindTexture(GL_TEXTURE_2D, mGLTexture);
+	glTexSubImage2D(
+		GL_TEXTURE_2D, 0, 0, 0, 4, 1, GL_RGBA, GL_FLOAT, invHeadTransform
+	);
+#endif
+}
+
+int64_t LateLatch::getLatchTime() const
+{
+	return mTextureReady ? mLastUpdate : 0;
+}
+
+void LateLatch::frameRendered()
+{
+	++mRenderedFrames;
+}
+
+void LateLatch::endRender()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(!mResourcesReady)
+	{
+		// bgfx does not own the texture
+		if(mTextureReady) { glDeleteTextures(1, &mGLTexture); }
+		mGLTexture = 0;
+		mTextureReady = false;
+		mTextureRequested = false;
+		return;
+	}
+
+	if(!mTextureRequested || mTextureReady) { return; }
+
+	float identity[16];
+	bx::mtxIdentity(identity);
+
+	GLuint glTexture;
+	glGenTextures(1, &glTexture);
+	glBindTexture(GL_TEXTURE_2D, glTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_RGBA32F, 4, 1, 0, GL_RGBA, GL_FLOAT, identity
+	);
+
+	bgfx::overrideInternal(mTexture, glTexture);
+	mGLTexture = glTexture;
+	mTextureReady = true;
+	XVR_LOG(Debug, "Late latch texture bound");
+#endif
+}
+
+}
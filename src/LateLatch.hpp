@@ -0,0 +1,75 @@
+#ifndef XVEEARR_LATE_LATCH_HPP
+#define XVEEARR_LATE_LATCH_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <bx/sem.h>
+#include <bgfx/bgfx.h>
+#include "IRenderHook.hpp"
+
+namespace xveearr
+{
+
+class IHMD;
+class FrameScheduler;
+
+// Keeps the inverse head transform in a 4x1 float texture which the render
+// thread rewrites right before bgfx renders a frame. Submitted frames never
+// change, only the texture they sample does. The render thread waits for
+// the frame to be submitted before sampling the pose. Requires the OpenGL
+// renderer.
+class LateLatch: public IRenderHook
+{
+public:
+	LateLatch();
+
+	void init(IHMD* hmd, const FrameScheduler* frameScheduler);
+
+	// Main thread, after bgfx is initialized
+	void prepareResources();
+	// Must be called before bgfx::shutdown or the render thread would keep
+	// waiting for frames
+	void releaseResources();
+	bool isEnabled() const;
+	// Right after bgfx::frame, with the number it returned
+	void frameSubmitted(uint32_t frame);
+	bgfx::TextureHandle getTexture() const;
+
+	// Render thread, the transform written by the last beginRender
+	void getHeadTransform(float* headTransform) const;
+	// Render thread, when the last beginRender sampled the pose, 0 when it
+	// did not
+	int64_t getLatchTime() const;
+	// Render thread, whenever bgfx::renderFrame rendered a frame
+	void frameRendered();
+
+	void initRenderer();
+	void shutdownRenderer();
+	void beginRender();
+	void endRender();
+
+private:
+	IHMD* mHMD;
+	const FrameScheduler* mFrameScheduler;
+	bool mEnabled;
+	bgfx::TextureHandle mTexture;
+	std::atomic<bool> mResourcesReady;
+	// bgfx numbers frames in submission order from 1 and renders each once
+	std::atomic<uint32_t> mSubmittedFrame;
+	// The frame which creates mTexture, 0 while unknown
+	std::atomic<uint32_t> mTextureFrame;
+	bx::Semaphore mFrameSem;
+	// Main thread only
+	bool mTexturePending;
+	// Render thread only
+	uint32_t mRenderedFrames;
+	bool mTextureRequested;
+	bool mTextureReady;
+	uint32_t mGLTexture;
+	int64_t mLastUpdate;
+	float mHeadTransform[16];
+};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "Latency.hpp"
+#include <bx/bx.h>
+#include <bx/timer.h>
+#include "Metrics.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Weight of a new sample in the moving averages
+static const double gSmoothing = 0.1;
+// In seconds, from well within a frame to several frames
+static const double gLatencyBuckets[] = {
+	0.005, 0.01, 0.015, 0.02, 0.025, 0.033, 0.05, 0.075, 0.1, 0.15, 0.25, 0.5
+};
+
+static Histogram gMotionToPhotonMetric(
+	"xveearr_motion_to_photon_seconds",
+	"Time from the head pose sample to the end of rendering",
+	gLatencyBuckets, BX_COUNTOF(gLatencyBuckets)
+);
+static Histogram gContentToPhotonMetric(
+	"xveearr_content_to_photon_seconds",
+	"Time from reading a window change to the end of rendering",
+	gLatencyBuckets, BX_COUNTOF(gLatencyBuckets)
+);
+
+}
+
+LatencyTracker::LatencyTracker()
+	:mPoseTime(0)
+	,mContentTime(0)
+	,mFirstSubmission(0)
+	,mNumSubmissions(0)
+	,mNumConsumed(0)
+	,mMotionToPhoton(0.0)
+	,mContentToPhoton(0.0)
+	,mNumCompletions(0)
+{
+}
+
+void LatencyTracker::poseSampled(int64_t time)
+{
+	mPoseTime.store(time, std::memory_order_relaxed);
+}
+
+void LatencyTracker::contentChanged(int64_t time)
+{
+	if(mContentTime == 0 || time < mContentTime) { mContentTime = time; }
+}
+
+void LatencyTracker::frameSubmitted(int64_t now)
+{
+	// Frames are not being rendered, only the latest ones are kept
+	if(mNumSubmissions == MaxSubmissions)
+	{
+		mFirstSubmission = (mFirstSubmission + 1) % MaxSubmissions;
+		--mNumSubmissions;
+	}
+
+	Submission& submission =
+		mSubmissions[(mFirstSubmission + mNumSubmissions) % MaxSubmissions];
+	submission.mSubmitTime = now;
+	submission.mPoseTime = mPoseTime.load(std::memory_order_relaxed);
+	submission.mContentTime = mContentTime;
+	++mNumSubmissions;
+	mContentTime = 0;
+}
+
+void LatencyTracker::update()
+{
+	unsigned int numCompletions = mNumCompletions.load(std::memory_order_acquire);
+	// The oldest ones were overwritten
+	if(numCompletions - mNumConsumed > MaxCompletions)
+	{
+		mNumConsumed = numCompletions - MaxCompletions;
+	}
+
+	while(mNumConsumed != numCompletions)
+	{
+		const Completion& completion = mCompletions[mNumConsumed % MaxCompletions];
+		++mNumConsumed;
+
+		// Frames bgfx renders on its own during initialization
+		if(mNumSubmissions == 0) { continue; }
+		const Submission& submission = mSubmissions[mFirstSubmission];
+		if(completion.mRenderTime < submission.mSubmitTime) { continue; }
+
+		record(submission, completion);
+		mFirstSubmission = (mFirstSubmission + 1) % MaxSubmissions;
+		--mNumSubmissions;
+	}
+}
+
+double LatencyTracker::getMotionToPhoton() const
+{
+	return mMotionToPhoton;
+}
+
+double LatencyTracker::getContentToPhoton() const
+{
+	return mContentToPhoton;
+}
+
+void LatencyTracker::frameRendered(int64_t now, int64_t latchTime)
+{
+	unsigned int index = mNumCompletions.load(std::memory_order_relaxed);
+	Completion& completion = mCompletions[index % MaxCompletions];
+	completion.mRenderTime = now;
+	completion.mLatchTime = latchTime;
+	mNumCompletions.store(index + 1, std::memory_order_release);
+}
+
+void LatencyTracker::record(
+	const Submission& submission, const Completion& completion
+)
+{
+	double toSeconds = 1.0 / (double)bx::getHPFrequency();
+
+	int64_t poseTime = completion.mLatchTime != 0
+		? completion.mLatchTime
+		: submission.mPoseTime;
+	if(poseTime != 0)
+	{
+		double latency = (double)(completion.mRenderTime - poseTime) * toSeconds;
+		gMotionToPhotonMetric.observe(latency);
+		mMotionToPhoton = mMotionToPhoton == 0.0
+			? latency
+			: mMotionToPhoton + (latency - mMotionToPhoton) * gSmoothing;
+	}
+
+	if(submission.mContentTime != 0)
+	{
+		double latency =
+			(double)(completion.mRenderTime - submission.mContentTime) * toSeconds;
+		gContentToPhotonMetric.observe(latency);
+		mContentToPhoton = mContentToPhoton == 0.0
+			? latency
+			: mContentToPhoton + (latency - mContentToPhoton) * gSmoothing;
+	}
+}
+
+}
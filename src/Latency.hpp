@@ -0,0 +1,73 @@
+#ifndef XVEEARR_LATENCY_HPP
+#define XVEEARR_LATENCY_HPP
+
+#include <cstdint>
+#include <atomic>
+
+namespace xveearr
+{
+
+// Measures how long input takes to be rendered. Motion-to-photon runs from
+// the head pose sample used by a frame, content-to-photon from the earliest
+// window change received since the previous frame, both to the end of the
+// frame's rendering. bgfx renders every submitted frame exactly once and in
+// order so rendered frames are paired with submitted ones by order. Results
+// go to histogram metrics. Times are in bx::getHPCounter ticks.
+class LatencyTracker
+{
+public:
+	LatencyTracker();
+
+	// Any thread, before the frame using the pose is submitted
+	void poseSampled(int64_t time);
+	// Main thread, time is when the window system received the change
+	void contentChanged(int64_t time);
+	// Right before bgfx::frame
+	void frameSubmitted(int64_t now);
+	// After bgfx::frame, pairs the frames rendered so far
+	void update();
+	// Moving averages in seconds, 0 before the first frame
+	double getMotionToPhoton() const;
+	double getContentToPhoton() const;
+
+	// Render thread, once bgfx rendered a frame. latchTime is when the pose
+	// was late latched, 0 when the frame uses the submitted pose.
+	void frameRendered(int64_t now, int64_t latchTime);
+
+private:
+	static const unsigned int MaxSubmissions = 8;
+	static const unsigned int MaxCompletions = 64;
+
+	struct Submission
+	{
+		int64_t mSubmitTime;
+		int64_t mPoseTime;
+		// 0 when nothing changed
+		int64_t mContentTime;
+	};
+
+	struct Completion
+	{
+		int64_t mRenderTime;
+		int64_t mLatchTime;
+	};
+
+	void record(const Submission& submission, const Completion& completion);
+
+	std::atomic<int64_t> mPoseTime;
+	int64_t mContentTime;
+	// Main thread only, oldest at mFirstSubmission
+	Submission mSubmissions[MaxSubmissions];
+	unsigned int mFirstSubmission;
+	unsigned int mNumSubmissions;
+	unsigned int mNumConsumed;
+	double mMotionToPhoton;
+	double mContentToPhoton;
+	// Written by the render thread, published by mNumCompletions
+	Completion mCompletions[MaxCompletions];
+	std::atomic<unsigned int> mNumCompletions;
+};
+
+}
+
+#endif
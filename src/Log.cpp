@@ -1,7 +1,16 @@
 #include "Log.hpp"
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <streambuf>
+#include <bx/mutex.h>
+#include <bx/sem.h>
 #include <bx/string.h>
+#include <bx/thread.h>
+#include <bx/timer.h>
 
 namespace xveearr
 {
@@ -17,6 +26,179 @@ static const char* gLevelLabels[] = {
 	"ERROR"
 };
 
+// Longer lines are truncated
+static const unsigned int gMaxLineLength = 1024;
+// Per thread, must be a power of two
+static const uint32_t gRingSize = 1 << 16;
+static const unsigned int gBatchSize = 1 << 16;
+static const int32_t gFlushIntervalMs = 10;
+
+// Formats into a fixed buffer, characters past its end are discarded
+class LineBuffer: public std::streambuf
+{
+public:
+	LineBuffer()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		setp(mData, mData + gMaxLineLength);
+	}
+
+	const char* getData() const { return pbase(); }
+	uint16_t getSize() const { return (uint16_t)(pptr() - pbase()); }
+
+protected:
+	int_type overflow(int_type ch)
+	{
+		return traits_type::not_eof(ch);
+	}
+
+private:
+	char mData[gMaxLineLength];
+};
+
+struct LineStream
+{
+	LineStream()
+		:mStream(&mBuffer)
+		,mOpen(false)
+	{}
+
+	LineBuffer mBuffer;
+	std::ostream mStream;
+	// A Log of this thread is being formatted
+	bool mOpen;
+};
+
+// Lines of one thread, each one is its length followed by its characters
+struct ThreadRing
+{
+	ThreadRing* mNext;
+	// Written by the owning thread
+	std::atomic<uint32_t> mWrite;
+	// Written by the thread draining the ring
+	std::atomic<uint32_t> mRead;
+	char mData[gRingSize];
+};
+
+static std::atomic<ThreadRing*> gRings(NULL);
+static std::atomic<bool> gAsync(false);
+static std::atomic<bool> gRunning(false);
+static std::atomic<unsigned int> gNumDropped(0);
+static bx::Thread gWriterThread;
+static bx::Semaphore gWakeSem;
+// Only one thread writes batches at a time
+static bx::Mutex gDrainMutex;
+static char gBatch[gBatchSize];
+static unsigned int gBatchLength = 0;
+thread_local LineStream tLine;
+thread_local ThreadRing* tRing = NULL;
+
+ThreadRing* getThreadRing()
+{
+	if(tRing != NULL) { return tRing; }
+
+	ThreadRing* ring = new ThreadRing;
+	ring->mWrite.store(0, std::memory_order_relaxed);
+	ring->mRead.store(0, std::memory_order_relaxed);
+
+	// Lock-free push to the front of the list
+	ring->mNext = gRings.load(std::memory_order_relaxed);
+	while(!gRings.compare_exchange_weak(
+		ring->mNext, ring,
+		std::memory_order_release, std::memory_order_relaxed
+	))
+	{}
+
+	tRing = ring;
+	return ring;
+}
+
+void copyToRing(ThreadRing* ring, uint32_t pos, const void* src, uint32_t size)
+{
+	uint32_t offset = pos & (gRingSize - 1);
+	uint32_t first = std::min(size, gRingSize - offset);
+	memcpy(ring->mData + offset, src, first);
+	memcpy(ring->mData, (const char*)src + first, size - first);
+}
+
+void copyFromRing(const ThreadRing* ring, uint32_t pos, void* dst, uint32_t size)
+{
+	uint32_t offset = pos & (gRingSize - 1);
+	uint32_t first = std::min(size, gRingSize - offset);
+	memcpy(dst, ring->mData + offset, first);
+	memcpy((char*)dst + first, ring->mData, size - first);
+}
+
+bool pushLine(ThreadRing* ring, const char* line, uint16_t size)
+{
+	uint32_t write = ring->mWrite.load(std::memory_order_relaxed);
+	uint32_t read = ring->mRead.load(std::memory_order_acquire);
+	uint32_t recordSize = (uint32_t)sizeof(size) + size;
+	if(gRingSize - (write - read) < recordSize) { return false; }
+
+	copyToRing(ring, write, &size, sizeof(size));
+	copyToRing(ring, write + sizeof(size), line, size);
+	// Publishes the line to the writer
+	ring->mWrite.store(write + recordSize, std::memory_order_release);
+	return true;
+}
+
+void writeBatch(std::ostream& stream)
+{
+	stream.write(gBatch, gBatchLength);
+	gBatchLength = 0;
+}
+
+// Lines of a thread keep their order, lines of different threads are only
+// ordered within a batch interval
+void drainRings(std::ostream& stream)
+{
+	bx::MutexScope lock(gDrainMutex);
+
+	for(
+		ThreadRing* ring = gRings.load(std::memory_order_acquire);
+		ring != NULL;
+		ring = ring->mNext
+	)
+	{
+		uint32_t read = ring->mRead.load(std::memory_order_relaxed);
+		uint32_t write = ring->mWrite.load(std::memory_order_acquire);
+		while(read != write)
+		{
+			uint16_t size;
+			copyFromRing(ring, read, &size, sizeof(size));
+			if(gBatchSize - gBatchLength < (unsigned int)size + 1)
+			{
+				writeBatch(stream);
+			}
+
+			copyFromRing(ring, read + sizeof(size), gBatch + gBatchLength, size);
+			gBatchLength += size;
+			gBatch[gBatchLength++] = '\n';
+			read += (uint32_t)sizeof(size) + size;
+		}
+		ring->mRead.store(read, std::memory_order_release);
+	}
+
+	writeBatch(stream);
+	stream.flush();
+}
+
+int32_t writerMain(void*)
+{
+	while(gRunning.load(std::memory_order_relaxed))
+	{
+		gWakeSem.wait(gFlushIntervalMs);
+		Log::flush();
+	}
+
+	return 0;
+}
+
 }
 
 Log::Level Log::sLogLevel = Log::Info;
@@ -27,26 +209,83 @@ Log::Log(Log::Level level, const char* file, unsigned int line)
 	,mFile(file)
 	,mLine(line)
 	,mOpened(level >= sLogLevel)
+	,mStream(NULL)
 {
-	if(mOpened)
+	if(!mOpened) { return; }
+
+	// Logging while formatting another line of the same thread, e.g. from
+	// a function called in the arguments
+	LineStream& lineStream = tLine;
+	if(lineStream.mOpen)
 	{
-		std::stringstream ss;
-		ss << mFile << ":" << mLine;
-		std::cout << std::left
-			<< "[" << std::setw(5) << gLevelLabels[mLevel] << std::setw(0) << "] @ "
-			<< std::setw(25) << ss.str() << std::setw(0) << std::internal
-			<< ": ";
+		gNumDropped.fetch_add(1, std::memory_order_relaxed);
+		mOpened = false;
+		return;
 	}
+
+	lineStream.mOpen = true;
+	mStream = &lineStream.mStream;
+	// The stream is reused, manipulators of a previous line must not leak
+	mStream->flags(std::ios_base::dec | std::ios_base::skipws);
+	mStream->precision(6);
+	mStream->fill(' ');
+	mStream->width(0);
+
+	// Formatted on the stack, a stringstream would allocate every line
+	char location[256];
+	snprintf(location, sizeof(location), "%s:%u", mFile, mLine);
+	*mStream << std::left
+		<< "[" << std::setw(5) << gLevelLabels[mLevel] << std::setw(0) << "] @ "
+		<< std::setw(25) << location << std::setw(0) << std::internal
+		<< ": ";
 }
 
 Log::~Log()
 {
-	if(mOpened) { std::cout << std::endl; }
+	if(!mOpened) { return; }
+
+	LineStream& lineStream = tLine;
+	LineBuffer& buffer = lineStream.mBuffer;
+	bool async = gAsync.load(std::memory_order_acquire);
+	if(async)
+	{
+		if(!pushLine(getThreadRing(), buffer.getData(), buffer.getSize()))
+		{
+			gNumDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	else
+	{
+		sOutputStream->write(buffer.getData(), buffer.getSize());
+		*sOutputStream << std::endl;
+	}
+	buffer.reset();
+	lineStream.mOpen = false;
+
+	if(!async) { return; }
+
+	// Errors often come right before an exit
+	if(mLevel >= Error)
+	{
+		flush();
+	}
+	else if(mLevel >= Warn)
+	{
+		gWakeSem.post();
+	}
 }
 
 void Log::setLogLevel(Log::Level level)
 {
 	sLogLevel = level;
+
+	if(level < Log::XVR_LOG_MIN_LEVEL)
+	{
+		XVR_LOG(Warn,
+			"Lines below ", gLevelLabels[Log::XVR_LOG_MIN_LEVEL],
+			" were compiled out"
+		);
+	}
 }
 
 void Log::setOutputStream(std::ostream& stream)
@@ -82,4 +321,88 @@ Log::Level Log::parseLogLevel(const char* level)
 	}
 }
 
+void Log::startAsync()
+{
+	if(gAsync.load(std::memory_order_relaxed)) { return; }
+
+	gRunning.store(true, std::memory_order_relaxed);
+	gAsync.store(true, std::memory_order_release);
+	gWriterThread.init(writerMain, NULL, 0, "Log thread");
+}
+
+void Log::stopAsync()
+{
+	if(!gAsync.load(std::memory_order_relaxed)) { return; }
+
+	gRunning.store(false, std::memory_order_relaxed);
+	gWakeSem.post();
+	gWriterThread.shutdown();
+
+	gAsync.store(false, std::memory_order_release);
+	flush();
+
+	ThreadRing* ring = gRings.exchange(NULL, std::memory_order_acquire);
+	while(ring != NULL)
+	{
+		ThreadRing* next = ring->mNext;
+		delete ring;
+		ring = next;
+	}
+	// Only valid for the calling thread, the others are gone
+	tRing = NULL;
+}
+
+void Log::flush()
+{
+	drainRings(*sOutputStream);
+
+	unsigned int numDropped = gNumDropped.exchange(0, std::memory_order_relaxed);
+	if(numDropped > 0)
+	{
+		XVR_LOG(Warn, numDropped, " log line(s) dropped, ring buffers were full");
+	}
+}
+
+LogRateLimiter::LogRateLimiter(unsigned int maxCount, unsigned int intervalMs)
+	:mMaxCount(maxCount)
+	,mInterval((int64_t)intervalMs * bx::getHPFrequency() / 1000)
+	,mWindowStart(bx::getHPCounter())
+	,mCount(0)
+	,mNumSuppressed(0)
+{}
+
+bool LogRateLimiter::acquire(unsigned int& numSuppressed)
+{
+	int64_t now = bx::getHPCounter();
+	int64_t windowStart = mWindowStart.load(std::memory_order_relaxed);
+	if(
+		now - windowStart >= mInterval
+		&& mWindowStart.compare_exchange_strong(
+			windowStart, now, std::memory_order_relaxed
+		)
+	)
+	{
+		mCount.store(0, std::memory_order_relaxed);
+	}
+
+	if(mCount.fetch_add(1, std::memory_order_relaxed) >= mMaxCount)
+	{
+		mNumSuppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	numSuppressed = mNumSuppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+std::ostream& operator<<(std::ostream& stream, const LogSuppressed& suppressed)
+{
+	if(suppressed.mCount > 0)
+	{
+		stream << " (" << suppressed.mCount << " similar line(s) suppressed)";
+	}
+
+	return stream;
+}
+
 }
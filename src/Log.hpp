@@ -1,11 +1,41 @@
 #ifndef XVEEARR_LOG_HPP
 #define XVEEARR_LOG_HPP
 
+#include <cstdint>
+#include <atomic>
 #include <iosfwd>
 #include <bx/macros.h>
 
+// Lines below this level are compiled out, e.g.
+// CPP_FLAGS=-DXVR_LOG_MIN_LEVEL=Info
+#ifndef XVR_LOG_MIN_LEVEL
+#	define XVR_LOG_MIN_LEVEL Trace
+#endif
+
+#define XVR_LOG_ENABLED(LEVEL) \
+	(::xveearr::Log::LEVEL >= ::xveearr::Log::XVR_LOG_MIN_LEVEL \
+		&& ::xveearr::Log::isEnabled(::xveearr::Log::LEVEL))
+
+// Arguments are not evaluated when the level is disabled. The if/else form
+// keeps an else following the macro bound to the caller's if.
 #define XVR_LOG(LEVEL, ...) \
-	::xveearr::Log(::xveearr::Log::LEVEL, __FILE__, __LINE__), __VA_ARGS__
+	if(!XVR_LOG_ENABLED(LEVEL)) {} else \
+		::xveearr::Log(::xveearr::Log::LEVEL, __FILE__, __LINE__), __VA_ARGS__
+
+// Logs at most MAX_COUNT lines per INTERVAL_MS from this call site, for
+// sites hit every frame or event. The next line let through tells how many
+// were suppressed.
+#define XVR_LOG_RATE_LIMITED(LEVEL, MAX_COUNT, INTERVAL_MS, ...) \
+	do { \
+		if(XVR_LOG_ENABLED(LEVEL)) { \
+			static ::xveearr::LogRateLimiter xvrLogLimiter(MAX_COUNT, INTERVAL_MS); \
+			unsigned int xvrNumSuppressed; \
+			if(xvrLogLimiter.acquire(xvrNumSuppressed)) { \
+				XVR_LOG(LEVEL, __VA_ARGS__, \
+					::xveearr::LogSuppressed(xvrNumSuppressed)); \
+			} \
+		} \
+	} while(0)
 
 #define XVR_ENSURE(EXP, ...) \
 	do { \
@@ -41,19 +71,66 @@ public:
 	template<typename T>
 	Log& operator<<(const T& msg);
 
+	static bool isEnabled(Level level)
+	{
+		return level >= sLogLevel;
+	}
+
 	static void setLogLevel(Level level);
 	static void setOutputStream(std::ostream& stream);
 	static Level parseLogLevel(const char* level);
+
+	// From now on lines are queued in a ring buffer of the logging thread
+	// and written in batches by a background thread. Lines are written
+	// right away before this and after stopAsync.
+	static void startAsync();
+	// Writes every queued line then stops the background thread. Must be
+	// called after the other threads stopped logging.
+	static void stopAsync();
+	// Writes every line queued so far from the calling thread
+	static void flush();
 private:
 	Level mLevel;
 	const char* mFile;
 	unsigned int mLine;
 	bool mOpened;
+	// The calling thread's line buffer
+	std::ostream* mStream;
 
 	static Level sLogLevel;
 	static std::ostream* sOutputStream;
 };
 
+class LogRateLimiter
+{
+public:
+	LogRateLimiter(unsigned int maxCount, unsigned int intervalMs);
+
+	// numSuppressed is set to the number of lines held back since the last
+	// one let through. Thread-safe, the limit is approximate under
+	// contention.
+	bool acquire(unsigned int& numSuppressed);
+
+private:
+	unsigned int mMaxCount;
+	int64_t mInterval;
+	std::atomic<int64_t> mWindowStart;
+	std::atomic<unsigned int> mCount;
+	std::atomic<unsigned int> mNumSuppressed;
+};
+
+// Appended to rate limited lines, prints nothing when nothing was suppressed
+struct LogSuppressed
+{
+	explicit LogSuppressed(unsigned int count)
+		:mCount(count)
+	{}
+
+	unsigned int mCount;
+};
+
+std::ostream& operator<<(std::ostream& stream, const LogSuppressed& suppressed);
+
 }
 
 #include "Log.inl"
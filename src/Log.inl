@@ -1,5 +1,5 @@
 #include "Log.hpp"
-#include <sstream>
+#include <ostream>
 
 namespace xveearr
 {
@@ -13,7 +13,7 @@ inline Log& Log::operator,(const T& msg)
 template<typename T>
 inline Log& Log::operator<<(const T& msg)
 {
-	if(mOpened) { *sOutputStream << msg; }
+	if(mOpened) { *mStream << msg; }
 	return *this;
 }
 
@@ -0,0 +1,141 @@
+#include "Metrics.hpp"
+#include <cstdio>
+#include <bx/bx.h>
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Constant-initialized so metrics in other translation units can register
+// during static initialization
+static std::atomic<Metric*> gFirstMetric(NULL);
+
+void appendValue(std::string& out, const char* name, const char* suffix, double value)
+{
+	char buff[256];
+	snprintf(buff, sizeof(buff), "%s%s %.17g\n", name, suffix, value);
+	out += buff;
+}
+
+}
+
+Metric::Metric(const char* name, const char* help)
+	:mName(name)
+	,mHelp(help)
+{
+	mNext = gFirstMetric.load(std::memory_order_relaxed);
+	while(!gFirstMetric.compare_exchange_weak(
+		mNext, this, std::memory_order_release, std::memory_order_relaxed
+	))
+	{}
+}
+
+const Metric* Metric::getFirst()
+{
+	return gFirstMetric.load(std::memory_order_acquire);
+}
+
+const Metric* Metric::getNext() const
+{
+	return mNext;
+}
+
+const char* Metric::getName() const
+{
+	return mName;
+}
+
+void Metric::formatHeader(std::string& out, const char* type) const
+{
+	out += "# HELP ";
+	out += mName;
+	out += ' ';
+	out += mHelp;
+	out += "\n# TYPE ";
+	out += mName;
+	out += ' ';
+	out += type;
+	out += '\n';
+}
+
+Counter::Counter(const char* name, const char* help)
+	:Metric(name, help)
+	,mValue(0)
+{
+}
+
+void Counter::format(std::string& out) const
+{
+	formatHeader(out, "counter");
+	appendValue(
+		out, getName(), "", (double)mValue.load(std::memory_order_relaxed)
+	);
+}
+
+Gauge::Gauge(const char* name, const char* help)
+	:Metric(name, help)
+	,mValue(0)
+{
+}
+
+void Gauge::format(std::string& out) const
+{
+	formatHeader(out, "gauge");
+	appendValue(
+		out, getName(), "", (double)mValue.load(std::memory_order_relaxed)
+	);
+}
+
+Histogram::Histogram(
+	const char* name, const char* help,
+	const double* bounds, unsigned int numBounds
+)
+	:Metric(name, help)
+	,mBounds(bounds)
+	,mNumBounds(numBounds < MaxBuckets ? numBounds : MaxBuckets)
+	,mSum(0.0)
+{
+	for(std::atomic<uint64_t>& bucket: mBuckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+void Histogram::observe(double value)
+{
+	unsigned int bucket = 0;
+	while(bucket < mNumBounds && value > mBounds[bucket]) { ++bucket; }
+	mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+	double sum = mSum.load(std::memory_order_relaxed);
+	while(!mSum.compare_exchange_weak(
+		sum, sum + value, std::memory_order_relaxed
+	))
+	{}
+}
+
+void Histogram::format(std::string& out) const
+{
+	formatHeader(out, "histogram");
+
+	// Buckets are read one by one so a scrape may be off by the samples
+	// observed meanwhile
+	char suffix[64];
+	uint64_t count = 0;
+	for(unsigned int i = 0; i < mNumBounds; ++i)
+	{
+		count += mBuckets[i].load(std::memory_order_relaxed);
+		snprintf(suffix, sizeof(suffix), "_bucket{le=\"%g\"}", mBounds[i]);
+		appendValue(out, getName(), suffix, (double)count);
+	}
+	count += mBuckets[mNumBounds].load(std::memory_order_relaxed);
+	appendValue(out, getName(), "_bucket{le=\"+Inf\"}", (double)count);
+	appendValue(
+		out, getName(), "_sum", mSum.load(std::memory_order_relaxed)
+	);
+	appendValue(out, getName(), "_count", (double)count);
+}
+
+}
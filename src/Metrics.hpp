@@ -0,0 +1,97 @@
+#ifndef XVEEARR_METRICS_HPP
+#define XVEEARR_METRICS_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+namespace xveearr
+{
+
+// A named value exported in the Prometheus text format. Metrics are meant
+// to be static objects, they add themselves to a global list on
+// construction and are updated with relaxed atomics from any thread.
+class Metric
+{
+public:
+	static const Metric* getFirst();
+	const Metric* getNext() const;
+
+	const char* getName() const;
+	// Appends the HELP, TYPE and sample lines
+	virtual void format(std::string& out) const = 0;
+
+protected:
+	Metric(const char* name, const char* help);
+
+	void formatHeader(std::string& out, const char* type) const;
+
+private:
+	const char* mName;
+	const char* mHelp;
+	Metric* mNext;
+};
+
+class Counter: public Metric
+{
+public:
+	Counter(const char* name, const char* help);
+
+	void add(uint64_t amount = 1)
+	{
+		mValue.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	void format(std::string& out) const;
+
+private:
+	std::atomic<uint64_t> mValue;
+};
+
+class Gauge: public Metric
+{
+public:
+	Gauge(const char* name, const char* help);
+
+	void set(int64_t value)
+	{
+		mValue.store(value, std::memory_order_relaxed);
+	}
+
+	void add(int64_t amount)
+	{
+		mValue.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	void format(std::string& out) const;
+
+private:
+	std::atomic<int64_t> mValue;
+};
+
+class Histogram: public Metric
+{
+public:
+	static const unsigned int MaxBuckets = 16;
+
+	// Upper bounds in ascending order, at most MaxBuckets. The array must
+	// outlive the histogram.
+	Histogram(
+		const char* name, const char* help,
+		const double* bounds, unsigned int numBounds
+	);
+
+	void observe(double value);
+	void format(std::string& out) const;
+
+private:
+	const double* mBounds;
+	unsigned int mNumBounds;
+	// Not cumulative, the last one is +Inf
+	std::atomic<uint64_t> mBuckets[MaxBuckets + 1];
+	std::atomic<double> mSum;
+};
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include "MetricsServer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <bx/platform.h>
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
+
+#if BX_PLATFORM_LINUX == 1
+#	include <poll.h>
+#	include <unistd.h>
+#	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <sys/un.h>
+#endif
+
+namespace xveearr
+{
+
+namespace
+{
+
+// How often the server thread checks for shutdown
+static const int gPollIntervalMs = 100;
+// How long a client has to send its request before it gets the plain text
+static const int gRequestTimeoutMs = 50;
+
+static const char* gHttpHeader =
+	"HTTP/1.0 200 OK\r\n"
+	"Content-Type: text/plain; version=0.0.4\r\n"
+	"Connection: close\r\n"
+	"\r\n";
+
+}
+
+MetricsServer::MetricsServer()
+	:mPath(NULL)
+	,mSocket(-1)
+	,mRunning(false)
+{
+}
+
+bool MetricsServer::init(const char* path)
+{
+#if BX_PLATFORM_LINUX == 1
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	XVR_ENSURE(
+		strlen(path) < sizeof(addr.sun_path), "Socket path is too long: ", path
+	);
+	strcpy(addr.sun_path, path);
+
+	// A socket may be left behind by an instance which did not shut down
+	// cleanly, anything else is not ours to remove
+	struct stat existing;
+	if(lstat(path, &existing) == 0)
+	{
+		XVR_ENSURE(
+			S_ISSOCK(existing.st_mode),
+			path, " already exists and is not a socket"
+		);
+		XVR_ENSURE(
+			unlink(path) == 0,
+			"Could not remove stale socket ", path, ": ", strerror(errno)
+		);
+	}
+
+	mSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	XVR_ENSURE(mSocket >= 0, "Could not create metrics socket");
+
+	if(bind(mSocket, (const sockaddr*)&addr, sizeof(addr)) != 0
+		|| listen(mSocket, 4) != 0)
+	{
+		XVR_LOG(Error, "Could not listen on ", path, ": ", strerror(errno));
+		close(mSocket);
+		mSocket = -1;
+		return false;
+	}
+
+	mPath = path;
+	mRunning = true;
+	mThread.init(serverThread, this, 0, "Metrics thread");
+	XVR_LOG(Info, "Serving metrics on ", path);
+
+	return true;
+#else
+	BX_UNUSED(path);
+	XVR_LOG(Error, "The metrics endpoint requires UNIX domain sockets");
+	return false;
+#endif
+}
+
+void MetricsServer::shutdown()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(!mRunning) { return; }
+
+	mRunning = false;
+	mThread.shutdown();
+	close(mSocket);
+	unlink(mPath);
+	mSocket = -1;
+#endif
+}
+
+int32_t MetricsServer::serverThread(void* userData)
+{
+#if BX_PLATFORM_LINUX == 1
+	MetricsServer* self = static_cast<MetricsServer*>(userData);
+	Trace::setThreadName("Metrics thread");
+
+	while(self->mRunning)
+	{
+		pollfd pfd;
+		pfd.fd = self->mSocket;
+		pfd.events = POLLIN;
+		if(poll(&pfd, 1, gPollIntervalMs) <= 0) { continue; }
+
+		int client = accept4(self->mSocket, NULL, NULL, SOCK_CLOEXEC);
+		if(client < 0) { continue; }
+
+		self->serve(client);
+		close(client);
+	}
+#else
+	BX_UNUSED(userData);
+#endif
+
+	return 0;
+}
+
+void MetricsServer::serve(int client)
+{
+#if BX_PLATFORM_LINUX == 1
+	XVR_TRACE_SCOPE("serve metrics");
+
+	// Only the start of the request matters
+	bool http = false;
+	pollfd pfd;
+	pfd.fd = client;
+	pfd.events = POLLIN;
+	if(poll(&pfd, 1, gRequestTimeoutMs) > 0)
+	{
+		char request[512];
+		ssize_t size = recv(client, request, sizeof(request), 0);
+		http = size >= 4 && memcmp(request, "GET ", 4) == 0;
+	}
+
+	mResponse.clear();
+	if(http) { mResponse += gHttpHeader; }
+	for(
+		const Metric* metric = Metric::getFirst();
+		metric != NULL;
+		metric = metric->getNext()
+	)
+	{
+		metric->format(mResponse);
+	}
+
+	const char* data = mResponse.data();
+	size_t remaining = mResponse.size();
+	while(remaining > 0)
+	{
+		ssize_t sent = send(client, data, remaining, MSG_NOSIGNAL);
+		if(sent <= 0) { break; }
+
+		data += sent;
+		remaining -= sent;
+	}
+#else
+	BX_UNUSED(client);
+#endif
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef XVEEARR_METRICS_SERVER_HPP
+#define XVEEARR_METRICS_SERVER_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <bx/thread.h>
+
+namespace xveearr
+{
+
+// Serves every registered metric in the Prometheus text format on a UNIX
+// domain socket, from its own thread. Plain connections get the text right
+// away, HTTP requests (curl --unix-socket) get it as an HTTP response.
+class MetricsServer
+{
+public:
+	MetricsServer();
+
+	bool init(const char* path);
+	void shutdown();
+
+private:
+	static int32_t serverThread(void* userData);
+	void serve(int client);
+
+	const char* mPath;
+	int mSocket;
+	std::atomic<bool> mRunning;
+	bx::Thread mThread;
+	// Server thread only
+	std::string mResponse;
+};
+
+}
+
+#endif
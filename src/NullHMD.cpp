@@ -1,7 +1,10 @@
-#include "IHMD.hpp"
+#include "NullHMD.hpp"
 #include <bx/fpumath.h>
+#include <bx/timer.h>
 #include <SDL.h>
 #include "Registry.hpp"
+#include "Log.hpp"
+#include "Utils.hpp"
 
 namespace xveearr
 {
@@ -9,168 +12,263 @@ namespace xveearr
 namespace
 {
 
-const unsigned int gViewportWidth = 1280 / 2;
-const unsigned int gViewportHeight = 720;
+const unsigned int gDefaultViewportWidth = 1280 / 2;
+const unsigned int gDefaultViewportHeight = 720;
+const bgfx::TextureFormat::Enum gDefaultColorFormat = bgfx::TextureFormat::BGRA8;
+const bgfx::TextureFormat::Enum gDefaultDepthFormat = bgfx::TextureFormat::D16F;
 const float gLeftEye[] = { -0.03f, 0.f, 0.f };
 const float gRightEye[] = { 0.03f, 0.f, 0.f };
 float gLookAt[] = { 0.f, 0.f, -0.5f };
+// Do not extrapolate further than this (in seconds) from a stale pose
+const float gMaxPredictionTime = 0.1f;
 
 }
 
-class NullHMD: public IHMD
+NullHMD::NullHMD()
+	:mViewportWidth(gDefaultViewportWidth)
+	,mViewportHeight(gDefaultViewportHeight)
+	,mColorFormat(gDefaultColorFormat)
+	,mDepthFormat(gDefaultDepthFormat)
 {
-public:
-	NullHMD()
-	{
-		mRenderData[Eye::Left].mFrameBuffer = BGFX_INVALID_HANDLE;
-		mRenderData[Eye::Right].mFrameBuffer = BGFX_INVALID_HANDLE;
-	}
+	mRenderData[Eye::Left].mFrameBuffer = BGFX_INVALID_HANDLE;
+	mRenderData[Eye::Right].mFrameBuffer = BGFX_INVALID_HANDLE;
+	memset(mInputTranslation, 0, sizeof(mInputTranslation));
+	memset(mInputRotation, 0, sizeof(mInputRotation));
+}
 
-	bool init()
+bool NullHMD::init(const HMDCfg& cfg)
+{
+	if(cfg.mEyeWidth != 0) { mViewportWidth = cfg.mEyeWidth; }
+	if(cfg.mEyeHeight != 0) { mViewportHeight = cfg.mEyeHeight; }
+	if(cfg.mColorFormat != bgfx::TextureFormat::Count)
 	{
-		bx::mtxIdentity(mHeadTransform);
-
-		return true;
+		mColorFormat = cfg.mColorFormat;
 	}
-
-	void shutdown()
+	if(cfg.mDepthFormat != bgfx::TextureFormat::Count)
 	{
+		mDepthFormat = cfg.mDepthFormat;
 	}
 
-	void initRenderer()
-	{
-	}
+	bx::mtxIdentity(mPose.mTransform);
+	memset(mPose.mAngularVelocity, 0, sizeof(mPose.mAngularVelocity));
+	memset(mPose.mLinearVelocity, 0, sizeof(mPose.mLinearVelocity));
+	mPose.mTimestamp = bx::getHPCounter();
 
-	void shutdownRenderer()
-	{
-	}
+	return true;
+}
 
-	void beginRender()
-	{
-	}
+void NullHMD::shutdown()
+{
+}
 
-	void endRender()
-	{
-	}
+void NullHMD::initRenderer()
+{
+}
 
-	void prepareResources()
-	{
-		mRenderData[Eye::Left].mFrameBuffer = createEyeFB();
-		mRenderData[Eye::Right].mFrameBuffer = createEyeFB();
-	}
+void NullHMD::shutdownRenderer()
+{
+}
+
+void NullHMD::beginRender()
+{
+}
 
-	void releaseResources()
+void NullHMD::endRender()
+{
+}
+
+void NullHMD::prepareResources()
+{
+	const bgfx::Caps* caps = bgfx::getCaps();
+	if(!(caps->formats[mColorFormat] & BGFX_CAPS_FORMAT_TEXTURE_FRAMEBUFFER))
 	{
-		if(bgfx::isValid(mRenderData[Eye::Left].mFrameBuffer))
-		{
-			bgfx::destroyFrameBuffer(mRenderData[Eye::Left].mFrameBuffer);
-		}
-
-		if(bgfx::isValid(mRenderData[Eye::Right].mFrameBuffer))
-		{
-			bgfx::destroyFrameBuffer(mRenderData[Eye::Right].mFrameBuffer);
-		}
+		XVR_LOG(Warn, "Eye buffer color format is not supported");
+		mColorFormat = gDefaultColorFormat;
 	}
-
-	void getViewportSize(unsigned int& width, unsigned int& height)
+	if(!(caps->formats[mDepthFormat] & BGFX_CAPS_FORMAT_TEXTURE_FRAMEBUFFER))
 	{
-		width = gViewportWidth;
-		height = gViewportHeight;
+		XVR_LOG(Warn, "Eye buffer depth format is not supported");
+		mDepthFormat = gDefaultDepthFormat;
 	}
 
-	void getHeadTransform(float* headTransform)
+	mRenderData[Eye::Left].mFrameBuffer = createEyeFB();
+	mRenderData[Eye::Right].mFrameBuffer = createEyeFB();
+}
+
+void NullHMD::releaseResources()
+{
+	if(bgfx::isValid(mRenderData[Eye::Left].mFrameBuffer))
 	{
-		memcpy(headTransform, mHeadTransform, sizeof(mHeadTransform));
+		bgfx::destroyFrameBuffer(mRenderData[Eye::Left].mFrameBuffer);
 	}
 
-	const char* getName() const
+	if(bgfx::isValid(mRenderData[Eye::Right].mFrameBuffer))
 	{
-		return "null";
+		bgfx::destroyFrameBuffer(mRenderData[Eye::Right].mFrameBuffer);
 	}
+}
+
+void NullHMD::getViewportSize(unsigned int& width, unsigned int& height)
+{
+	width = mViewportWidth;
+	height = mViewportHeight;
+}
+
+void NullHMD::getHeadTransform(float* headTransform)
+{
+	bx::MutexScope lock(mPoseMutex);
+	memcpy(headTransform, mPose.mTransform, sizeof(mPose.mTransform));
+}
 
-	void update()
+void NullHMD::getHeadPose(HeadPose& pose)
+{
+	bx::MutexScope lock(mPoseMutex);
+	pose = mPose;
+}
+
+void NullHMD::getPredictedHeadTransform(int64_t targetTime, float* headTransform)
+{
+	HeadPose pose;
+	getHeadPose(pose);
+
+	float dt = (float)(targetTime - pose.mTimestamp)
+		/ (float)bx::getHPFrequency();
+	dt = bx::fclamp(dt, 0.f, gMaxPredictionTime);
+	utils::extrapolateTransform(
+		pose.mTransform, pose.mAngularVelocity, pose.mLinearVelocity,
+		dt, headTransform
+	);
+}
+
+void NullHMD::getViewTransform(
+	Eye::Enum eye, const float* headTransform, float* viewTransform
+)
+{
+	const float* eyeOffset = eye == Eye::Left ? gLeftEye : gRightEye;
+	float eyePos[3];
+	float lookAt[3];
+	float relLookAt[3];
+	bx::vec3MulMtx(eyePos, eyeOffset, headTransform);
+	bx::vec3Add(relLookAt, eyeOffset, gLookAt);
+	bx::vec3MulMtx(lookAt, relLookAt, headTransform);
+	bx::mtxLookAtRh(viewTransform, eyePos, lookAt);
+}
+
+const char* NullHMD::getName() const
+{
+	return "null";
+}
+
+void NullHMD::pollInput()
+{
+	const Uint8* keyStates = SDL_GetKeyboardState(NULL);
+	float* translation = mInputTranslation;
+	float* rotation = mInputRotation;
+	memset(translation, 0, sizeof(mInputTranslation));
+	memset(rotation, 0, sizeof(mInputRotation));
+
+	if(keyStates[SDL_SCANCODE_A]) { translation[0] = -0.004f; }
+	if(keyStates[SDL_SCANCODE_D]) { translation[0] =  0.004f; }
+	if(keyStates[SDL_SCANCODE_W]) { translation[2] = -0.004f; }
+	if(keyStates[SDL_SCANCODE_S]) { translation[2] =  0.004f; }
+	if(keyStates[SDL_SCANCODE_Q]) { rotation[1] = -0.01f; }
+	if(keyStates[SDL_SCANCODE_E]) { rotation[1] =  0.01f; }
+	if(keyStates[SDL_SCANCODE_R]) { rotation[0] = -0.01f; }
+	if(keyStates[SDL_SCANCODE_F]) { rotation[0] =  0.01f; }
+}
+
+void NullHMD::update()
+{
+	HeadPose pose;
+	moveHead(mPose.mTransform, pose.mTransform);
+	pose.mTimestamp = bx::getHPCounter();
+
+	float dt = (float)(pose.mTimestamp - mPose.mTimestamp)
+		/ (float)bx::getHPFrequency();
+	if(dt > 0.f)
 	{
-		const Uint8* keyStates = SDL_GetKeyboardState(NULL);
-		float translation[3] = {};
-		float rotation[3] = {};
-
-		if(keyStates[SDL_SCANCODE_A]) { translation[0] = -0.004f; }
-		if(keyStates[SDL_SCANCODE_D]) { translation[0] =  0.004f; }
-		if(keyStates[SDL_SCANCODE_W]) { translation[2] = -0.004f; }
-		if(keyStates[SDL_SCANCODE_S]) { translation[2] =  0.004f; }
-		if(keyStates[SDL_SCANCODE_Q]) { rotation[1] = -0.01f; }
-		if(keyStates[SDL_SCANCODE_E]) { rotation[1] =  0.01f; }
-		if(keyStates[SDL_SCANCODE_R]) { rotation[0] = -0.01f; }
-		if(keyStates[SDL_SCANCODE_F]) { rotation[0] =  0.01f; }
-
-		float move[16];
-		bx::mtxSRT(move,
-			1.f, 1.f, 1.f,
-			rotation[0], rotation[1], rotation[2],
-			translation[0], translation[1], translation[2]
-		);
-		float tmp[16];
-		memcpy(tmp, mHeadTransform, sizeof(tmp));
-		bx::mtxMul(mHeadTransform, move, tmp);
-
-		float leftEye[3];
-		float leftLookAt[3];
-		float leftRelLookat[3];
-		bx::vec3MulMtx(leftEye, gLeftEye, mHeadTransform);
-		bx::vec3Add(leftRelLookat, gLeftEye, gLookAt);
-		bx::vec3MulMtx(leftLookAt, leftRelLookat, mHeadTransform);
-		bx::mtxLookAtRh(
-			mRenderData[Eye::Left].mViewTransform, leftEye, leftLookAt
-		);
-		bx::mtxProjRh(mRenderData[Eye::Left].mViewProjection,
-			60.0f,
-			(float)gViewportWidth / (float)gViewportHeight,
-			0.15f, 10.f
+		utils::computeVelocity(
+			mPose.mTransform, pose.mTransform, dt,
+			pose.mAngularVelocity, pose.mLinearVelocity
 		);
-
-		float rightEye[3];
-		float rightLookAt[3];
-		float rightRelLookat[3];
-		bx::vec3MulMtx(rightEye, gRightEye, mHeadTransform);
-		bx::vec3Add(rightRelLookat, gRightEye, gLookAt);
-		bx::vec3MulMtx(rightLookAt, rightRelLookat, mHeadTransform);
-		bx::mtxLookAtRh(
-			mRenderData[Eye::Right].mViewTransform, rightEye, rightLookAt
+	}
+	else
+	{
+		memcpy(
+			pose.mAngularVelocity, mPose.mAngularVelocity,
+			sizeof(pose.mAngularVelocity)
 		);
-		bx::mtxProjRh(mRenderData[Eye::Right].mViewProjection,
-			60.0f,
-			(float)gViewportWidth / (float)gViewportHeight,
-			0.15f, 10.f
+		memcpy(
+			pose.mLinearVelocity, mPose.mLinearVelocity,
+			sizeof(pose.mLinearVelocity)
 		);
 	}
 
-	const RenderData& getRenderData(Eye::Enum eye)
 	{
-		return mRenderData[eye];
+		bx::MutexScope lock(mPoseMutex);
+		mPose = pose;
 	}
 
-private:
-	bgfx::FrameBufferHandle createEyeFB()
-	{
-		bgfx::TextureHandle textures[] = {
-			bgfx::createTexture2D(
-				gViewportWidth, gViewportHeight, 1,
-				bgfx::TextureFormat::BGRA8,
-				BGFX_TEXTURE_RT|BGFX_TEXTURE_U_CLAMP|BGFX_TEXTURE_V_CLAMP
-			),
-			bgfx::createTexture2D(
-				gViewportWidth, gViewportHeight, 1,
-				bgfx::TextureFormat::D16F,
-				BGFX_TEXTURE_RT_WRITE_ONLY
-			)
-		};
-
-		return bgfx::createFrameBuffer(BX_COUNTOF(textures), textures, true);
-	}
+	getViewTransform(
+		Eye::Left, pose.mTransform, mRenderData[Eye::Left].mViewTransform
+	);
+	bx::mtxProjRh(mRenderData[Eye::Left].mViewProjection,
+		60.0f,
+		(float)mViewportWidth / (float)mViewportHeight,
+		0.15f, 10.f
+	);
+
+	getViewTransform(
+		Eye::Right, pose.mTransform, mRenderData[Eye::Right].mViewTransform
+	);
+	bx::mtxProjRh(mRenderData[Eye::Right].mViewProjection,
+		60.0f,
+		(float)mViewportWidth / (float)mViewportHeight,
+		0.15f, 10.f
+	);
+}
+
+bool NullHMD::isReplay() const
+{
+	return false;
+}
 
-	float mHeadTransform[16];
-	RenderData mRenderData[Eye::Count];
-};
+const RenderData& NullHMD::getRenderData(Eye::Enum eye)
+{
+	return mRenderData[eye];
+}
+
+void NullHMD::moveHead(const float* headTransform, float* result)
+{
+	const float* translation = mInputTranslation;
+	const float* rotation = mInputRotation;
+
+	float move[16];
+	bx::mtxSRT(move,
+		1.f, 1.f, 1.f,
+		rotation[0], rotation[1], rotation[2],
+		translation[0], translation[1], translation[2]
+	);
+	bx::mtxMul(result, move, headTransform);
+}
+
+bgfx::FrameBufferHandle NullHMD::createEyeFB()
+{
+	bgfx::TextureHandle textures[] = {
+		bgfx::createTexture2D(
+			mViewportWidth, mViewportHeight, 1,
+			mColorFormat,
+			BGFX_TEXTURE_RT|BGFX_TEXTURE_U_CLAMP|BGFX_TEXTURE_V_CLAMP
+		),
+		bgfx::createTexture2D(
+			mViewportWidth, mViewportHeight, 1,
+			mDepthFormat,
+			BGFX_TEXTURE_RT_WRITE_ONLY
+		)
+	};
+
+	return bgfx::createFrameBuffer(BX_COUNTOF(textures), textures, true);
+}
 
 XVR_REGISTER(IHMD, NullHMD)
 
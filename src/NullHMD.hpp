@@ -0,0 +1,61 @@
+#ifndef XVEEARR_NULL_HMD_HPP
+#define XVEEARR_NULL_HMD_HPP
+
+#include <bx/mutex.h>
+#include "IHMD.hpp"
+
+namespace xveearr
+{
+
+// Renders into offscreen eye buffers shown by the mirror window. The head
+// is moved with the keyboard, subclasses can provide other motion.
+class NullHMD: public IHMD
+{
+public:
+	NullHMD();
+
+	bool init(const HMDCfg& cfg);
+	void shutdown();
+	void initRenderer();
+	void shutdownRenderer();
+	void beginRender();
+	void endRender();
+	void prepareResources();
+	void releaseResources();
+	void getViewportSize(unsigned int& width, unsigned int& height);
+	void getHeadTransform(float* headTransform);
+	void getHeadPose(HeadPose& pose);
+	void getPredictedHeadTransform(int64_t targetTime, float* headTransform);
+	void getViewTransform(
+		Eye::Enum eye, const float* headTransform, float* viewTransform
+	);
+	const char* getName() const;
+	void pollInput();
+	void update();
+	bool isReplay() const;
+	const RenderData& getRenderData(Eye::Enum eye);
+
+protected:
+	// Head transform for this update given the previous one, runs on a
+	// worker thread
+	virtual void moveHead(const float* headTransform, float* result);
+
+private:
+	bgfx::FrameBufferHandle createEyeFB();
+
+	unsigned int mViewportWidth;
+	unsigned int mViewportHeight;
+	bgfx::TextureFormat::Enum mColorFormat;
+	bgfx::TextureFormat::Enum mDepthFormat;
+	// Only written by update but read from other threads
+	HeadPose mPose;
+	bx::Mutex mPoseMutex;
+	RenderData mRenderData[Eye::Count];
+	// Sampled by pollInput
+	float mInputTranslation[3];
+	float mInputRotation[3];
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "PoseRecording.hpp"
+#include <cstring>
+#include "Log.hpp"
+#include "Utils.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const char gMagic[8] = { 'X', 'V', 'R', 'P', 'O', 'S', 'E', '1' };
+
+}
+
+PoseWriter::PoseWriter()
+	:mFile(NULL)
+{}
+
+bool PoseWriter::open(const char* path)
+{
+	mFile = fopen(path, "wb");
+	XVR_ENSURE(mFile != NULL, "Could not open ", path, " for writing");
+	if(fwrite(gMagic, sizeof(gMagic), 1, mFile) != 1)
+	{
+		close();
+		XVR_LOG(Error, "Could not write to ", path);
+		return false;
+	}
+
+	return true;
+}
+
+void PoseWriter::close()
+{
+	if(mFile == NULL) { return; }
+
+	fclose(mFile);
+	mFile = NULL;
+}
+
+bool PoseWriter::isOpen() const
+{
+	return mFile != NULL;
+}
+
+void PoseWriter::write(const float* headTransform, float deltaTime)
+{
+	PoseSample sample;
+	memcpy(sample.mPosition, &headTransform[12], sizeof(sample.mPosition));
+	utils::mtxToQuat(headTransform, sample.mRotation);
+	sample.mDeltaTime = deltaTime;
+
+	if(fwrite(&sample, sizeof(sample), 1, mFile) != 1)
+	{
+		XVR_LOG(Error, "Could not write head motion, recording stopped");
+		close();
+	}
+}
+
+bool loadPoseSamples(const char* path, std::vector<PoseSample>& samples)
+{
+	FILE* file = fopen(path, "rb");
+	XVR_ENSURE(file != NULL, "Could not open ", path);
+
+	char magic[sizeof(gMagic)];
+	bool valid = fread(magic, sizeof(magic), 1, file) == 1
+		&& memcmp(magic, gMagic, sizeof(gMagic)) == 0;
+	if(!valid)
+	{
+		fclose(file);
+		XVR_LOG(Error, path, " is not a head motion recording");
+		return false;
+	}
+
+	samples.clear();
+	PoseSample sample;
+	while(fread(&sample, sizeof(sample), 1, file) == 1)
+	{
+		samples.push_back(sample);
+	}
+	fclose(file);
+
+	return true;
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef XVEEARR_POSE_RECORDING_HPP
+#define XVEEARR_POSE_RECORDING_HPP
+
+#include <cstdio>
+#include <vector>
+
+namespace xveearr
+{
+
+// Head motion files start with an 8 byte magic followed by one PoseSample
+// per HMD update, in the byte order of the recording machine
+struct PoseSample
+{
+	float mPosition[3];
+	// Quaternion (x, y, z, w)
+	float mRotation[4];
+	// Seconds since the previous sample
+	float mDeltaTime;
+};
+
+class PoseWriter
+{
+public:
+	PoseWriter();
+
+	bool open(const char* path);
+	void close();
+	bool isOpen() const;
+	void write(const float* headTransform, float deltaTime);
+
+private:
+	FILE* mFile;
+};
+
+bool loadPoseSamples(const char* path, std::vector<PoseSample>& samples);
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "Profiler.hpp"
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <bx/bx.h>
+#include <bx/mutex.h>
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const unsigned int gMaxMarkers = 32;
+static const unsigned int gMaxNameLength = 32;
+static const unsigned int gHistorySize = 128;
+
+struct Marker
+{
+	char mName[gMaxNameLength];
+	// Summed since the last endFrame
+	std::atomic<int64_t> mPending;
+	std::atomic<unsigned int> mPendingCalls;
+	int64_t mHistory[gHistorySize];
+	unsigned int mCallHistory[gHistorySize];
+};
+
+static Marker gMarkers[gMaxMarkers];
+static std::atomic<unsigned int> gNumMarkers(0);
+static bx::Mutex gRegisterMutex;
+static int64_t gFrameTimes[gHistorySize];
+static unsigned int gNumFrames = 0;
+// Slot of the last ended frame
+static unsigned int gLastFrame = gHistorySize - 1;
+static int64_t gLastFrameEnd = 0;
+
+}
+
+unsigned int Profiler::registerMarker(const char* name)
+{
+	bx::MutexScope lock(gRegisterMutex);
+
+	unsigned int numMarkers = gNumMarkers.load(std::memory_order_relaxed);
+	for(unsigned int i = 0; i < numMarkers; ++i)
+	{
+		if(strncmp(gMarkers[i].mName, name, gMaxNameLength - 1) == 0)
+		{
+			return i;
+		}
+	}
+
+	if(numMarkers == gMaxMarkers) { return gMaxMarkers; }
+
+	Marker& marker = gMarkers[numMarkers];
+	strncpy(marker.mName, name, gMaxNameLength - 1);
+	marker.mName[gMaxNameLength - 1] = '\0';
+	marker.mPending.store(0, std::memory_order_relaxed);
+	marker.mPendingCalls.store(0, std::memory_order_relaxed);
+	std::fill(marker.mHistory, marker.mHistory + gHistorySize, 0);
+	std::fill(marker.mCallHistory, marker.mCallHistory + gHistorySize, 0u);
+	// Publishes the name to endFrame
+	gNumMarkers.store(numMarkers + 1, std::memory_order_release);
+
+	return numMarkers;
+}
+
+void Profiler::addTime(unsigned int marker, int64_t duration)
+{
+	if(marker >= gMaxMarkers) { return; }
+
+	gMarkers[marker].mPending.fetch_add(duration, std::memory_order_relaxed);
+	gMarkers[marker].mPendingCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::endFrame(int64_t now)
+{
+	gLastFrame = (gLastFrame + 1) % gHistorySize;
+	gFrameTimes[gLastFrame] = gLastFrameEnd != 0 ? now - gLastFrameEnd : 0;
+	gLastFrameEnd = now;
+	gNumFrames = std::min(gNumFrames + 1, gHistorySize);
+
+	unsigned int numMarkers = gNumMarkers.load(std::memory_order_acquire);
+	for(unsigned int i = 0; i < numMarkers; ++i)
+	{
+		gMarkers[i].mHistory[gLastFrame] =
+			gMarkers[i].mPending.exchange(0, std::memory_order_relaxed);
+		gMarkers[i].mCallHistory[gLastFrame] =
+			gMarkers[i].mPendingCalls.exchange(0, std::memory_order_relaxed);
+	}
+}
+
+unsigned int Profiler::getNumMarkers()
+{
+	return gNumMarkers.load(std::memory_order_acquire);
+}
+
+const char* Profiler::getMarkerName(unsigned int marker)
+{
+	// Names never change once registered
+	return marker < gMaxMarkers ? gMarkers[marker].mName : NULL;
+}
+
+int64_t Profiler::getLastTime(unsigned int marker)
+{
+	return gMarkers[marker].mHistory[gLastFrame];
+}
+
+unsigned int Profiler::getLastCalls(unsigned int marker)
+{
+	return gMarkers[marker].mCallHistory[gLastFrame];
+}
+
+void Profiler::getMarkerStats(
+	unsigned int marker, int64_t& average, int64_t& maximum
+)
+{
+	int64_t total = 0;
+	maximum = 0;
+	const int64_t* history = gMarkers[marker].mHistory;
+	for(unsigned int i = 0; i < gNumFrames; ++i)
+	{
+		unsigned int slot = (gLastFrame + gHistorySize - i) % gHistorySize;
+		total += history[slot];
+		maximum = std::max(maximum, history[slot]);
+	}
+
+	average = gNumFrames > 0 ? total / gNumFrames : 0;
+}
+
+double Profiler::getAverageCalls(unsigned int marker)
+{
+	unsigned int total = 0;
+	const unsigned int* history = gMarkers[marker].mCallHistory;
+	for(unsigned int i = 0; i < gNumFrames; ++i)
+	{
+		total += history[(gLastFrame + gHistorySize - i) % gHistorySize];
+	}
+
+	return gNumFrames > 0 ? (double)total / (double)gNumFrames : 0.0;
+}
+
+unsigned int Profiler::getFrameTimes(int64_t* frameTimes, unsigned int max)
+{
+	unsigned int numFrames = std::min(gNumFrames, max);
+	for(unsigned int i = 0; i < numFrames; ++i)
+	{
+		unsigned int slot =
+			(gLastFrame + gHistorySize - (numFrames - 1 - i)) % gHistorySize;
+		frameTimes[i] = gFrameTimes[slot];
+	}
+
+	return numFrames;
+}
+
+}
@@ -0,0 +1,78 @@
+#ifndef XVEEARR_PROFILER_HPP
+#define XVEEARR_PROFILER_HPP
+
+#include <cstdint>
+#include <bx/macros.h>
+#include <bx/timer.h>
+#include "Trace.hpp"
+
+// Adds the time until the end of the enclosing scope to the named marker.
+// The name is registered on first use.
+#define XVR_PROFILE_SCOPE(NAME) \
+	static const unsigned int BX_CONCATENATE(xvrProfileMarker, __LINE__) = \
+		::xveearr::Profiler::registerMarker(NAME); \
+	::xveearr::ProfileScope BX_CONCATENATE(xvrProfileScope, __LINE__)( \
+		BX_CONCATENATE(xvrProfileMarker, __LINE__) \
+	)
+
+namespace xveearr
+{
+
+// Per-frame CPU time of named stages on any thread. Times and the number of
+// times they were added are summed until the main thread ends the frame and
+// the last frames are kept in a ring buffer. Times are in bx::getHPCounter
+// ticks.
+class Profiler
+{
+public:
+	// Returns the same marker for the same name. When all markers are
+	// taken, times for new names are dropped.
+	static unsigned int registerMarker(const char* name);
+	static void addTime(unsigned int marker, int64_t duration);
+	// Main thread, right after bgfx::frame
+	static void endFrame(int64_t now);
+	// Any thread, NULL for the marker returned when all markers are taken
+	static const char* getMarkerName(unsigned int marker);
+
+	// Everything below is main thread only
+	static unsigned int getNumMarkers();
+	// Time in the last ended frame
+	static int64_t getLastTime(unsigned int marker);
+	static unsigned int getLastCalls(unsigned int marker);
+	// Over the frames in the ring buffer
+	static void getMarkerStats(
+		unsigned int marker, int64_t& average, int64_t& maximum
+	);
+	static double getAverageCalls(unsigned int marker);
+	// Oldest first, returns how many frames are in the ring buffer
+	static unsigned int getFrameTimes(int64_t* frameTimes, unsigned int max);
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(unsigned int marker)
+		:mMarker(marker)
+		,mStart(bx::getHPCounter())
+	{}
+
+	~ProfileScope()
+	{
+		int64_t end = bx::getHPCounter();
+		Profiler::addTime(mMarker, end - mStart);
+
+		if(Trace::isEnabled())
+		{
+			const char* name = Profiler::getMarkerName(mMarker);
+			if(name != NULL) { Trace::addEvent(name, mStart, end); }
+		}
+	}
+
+private:
+	unsigned int mMarker;
+	int64_t mStart;
+};
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "NullHMD.hpp"
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <bx/fpumath.h>
+#include <bx/commandline.h>
+#include "PoseRecording.hpp"
+#include "Registry.hpp"
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const double gDefaultReplayRate = 60.0;
+
+}
+
+// Plays back head motion recorded with --record-head. Every update moves
+// the recording forward by the same step no matter how long frames take so
+// runs see identical motion frame by frame. Loops at the end.
+class ReplayHMD: public NullHMD
+{
+public:
+	ReplayHMD()
+		:mStep(0.0)
+		,mTime(0.0)
+		,mDuration(0.0)
+	{}
+
+	bool init(const HMDCfg& cfg)
+	{
+		const char* path = cfg.mCmdLine->findOption("replay-file");
+		XVR_ENSURE(path != NULL, "The replay HMD requires --replay-file");
+		XVR_ENSURE(loadPoseSamples(path, mSamples), "Could not load ", path);
+		XVR_ENSURE(!mSamples.empty(), path, " does not contain any pose");
+
+		double rate = gDefaultReplayRate;
+		const char* rateStr = cfg.mCmdLine->findOption("replay-rate");
+		if(rateStr) { rate = atof(rateStr); }
+		XVR_ENSURE(rate > 0.0, "Invalid replay rate: ", rateStr);
+		mStep = 1.0 / rate;
+
+		// The first sample is the start of the recording
+		mSampleTimes.resize(mSamples.size());
+		double time = 0.0;
+		for(size_t i = 0; i < mSamples.size(); ++i)
+		{
+			if(i > 0) { time += mSamples[i].mDeltaTime; }
+			mSampleTimes[i] = time;
+		}
+		mDuration = time;
+		mTime = 0.0;
+
+		XVR_LOG(Info,
+			"Replaying ", mSamples.size(), " poses (", mDuration, " s) from ",
+			path
+		);
+
+		return NullHMD::init(cfg);
+	}
+
+	void shutdown()
+	{
+		mSamples.clear();
+		mSampleTimes.clear();
+		NullHMD::shutdown();
+	}
+
+	const char* getName() const
+	{
+		return "replay";
+	}
+
+	bool isReplay() const
+	{
+		return true;
+	}
+
+	// The pose of the last update, extrapolating it with wall-clock
+	// velocity would show different poses on every run
+	void getPredictedHeadTransform(int64_t targetTime, float* headTransform)
+	{
+		BX_UNUSED(targetTime);
+		getHeadTransform(headTransform);
+	}
+
+protected:
+	void moveHead(const float* headTransform, float* result)
+	{
+		BX_UNUSED(headTransform);
+
+		size_t next = std::upper_bound(
+			mSampleTimes.begin(), mSampleTimes.end(), mTime
+		) - mSampleTimes.begin();
+		size_t prev = next > 0 ? next - 1 : 0;
+		if(next >= mSamples.size()) { next = prev; }
+
+		const PoseSample& from = mSamples[prev];
+		const PoseSample& to = mSamples[next];
+		double span = mSampleTimes[next] - mSampleTimes[prev];
+		float t = span > 0.0 ? (float)((mTime - mSampleTimes[prev]) / span) : 0.f;
+
+		// Normalized lerp along the shorter arc
+		float dot = from.mRotation[0] * to.mRotation[0]
+			+ from.mRotation[1] * to.mRotation[1]
+			+ from.mRotation[2] * to.mRotation[2]
+			+ from.mRotation[3] * to.mRotation[3];
+		float sign = dot < 0.f ? -1.f : 1.f;
+		float rotation[4];
+		float length = 0.f;
+		for(int i = 0; i < 4; ++i)
+		{
+			rotation[i] = bx::flerp(
+				from.mRotation[i], to.mRotation[i] * sign, t
+			);
+			length += rotation[i] * rotation[i];
+		}
+		length = bx::fsqrt(length);
+		for(int i = 0; i < 4; ++i) { rotation[i] /= length; }
+
+		bx::mtxQuat(result, rotation);
+		result[12] = bx::flerp(from.mPosition[0], to.mPosition[0], t);
+		result[13] = bx::flerp(from.mPosition[1], to.mPosition[1], t);
+		result[14] = bx::flerp(from.mPosition[2], to.mPosition[2], t);
+
+		mTime += mStep;
+		if(mTime > mDuration) { mTime = 0.0; }
+	}
+
+private:
+	std::vector<PoseSample> mSamples;
+	// Start of each sample relative to the first one, in seconds
+	std::vector<double> mSampleTimes;
+	double mStep;
+	double mTime;
+	double mDuration;
+};
+
+XVR_REGISTER(IHMD, ReplayHMD)
+
+}
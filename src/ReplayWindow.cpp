@@ -0,0 +1,355 @@
+#include "IWindowSystem.hpp"
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <bx/bx.h>
+#include <bx/commandline.h>
+#include <bx/os.h>
+#include <bx/string.h>
+#include <bx/timer.h>
+#include "WindowEventLog.hpp"
+#include "Registry.hpp"
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Rows rewritten for a content update
+static const unsigned int gUpdateBandHeight = 32;
+static const unsigned int gCursorSize = 16;
+
+}
+
+// Feeds back window events written by --record-events. Geometry comes from
+// the recording, contents are flat colors since pixels are not recorded.
+// At original speed events come out with their recorded timing, at max
+// speed every pollEvents call returns the next recorded batch.
+class ReplayWindow: public IWindowSystem
+{
+public:
+	ReplayWindow()
+		:mWindows(NULL)
+		,mMaxSpeed(false)
+		,mStarted(false)
+		,mFinished(false)
+		,mStartTime(0)
+		,mNextRecord(0)
+		,mNextRecordTime(0)
+		,mEventIndex(0)
+	{
+		mCursor = BGFX_INVALID_HANDLE;
+		memset(&mDisplayMetrics, 0, sizeof(mDisplayMetrics));
+	}
+
+	bool probe()
+	{
+		return true;
+	}
+
+	bool isSynthetic() const
+	{
+		return true;
+	}
+
+	bool init(const WindowSystemCfg& cfg)
+	{
+		mWindows = cfg.mWindowTable;
+
+		const char* path = cfg.mCmdLine->findOption("replay-events");
+		XVR_ENSURE(path != NULL, "The replay window system requires --replay-events");
+		XVR_ENSURE(
+			loadWindowEvents(path, mDisplayMetrics, mRecords),
+			"Could not load ", path
+		);
+
+		const char* speed = cfg.mCmdLine->findOption("replay-speed", "original");
+		XVR_ENSURE(
+			bx::stricmp(speed, "original") == 0 || bx::stricmp(speed, "max") == 0,
+			"Invalid replay speed: ", speed
+		);
+		mMaxSpeed = bx::stricmp(speed, "max") == 0;
+
+		XVR_LOG(Info,
+			"Replaying ", mRecords.size(), " window event(s) from ", path,
+			" at ", speed, " speed"
+		);
+
+		return true;
+	}
+
+	void shutdown()
+	{
+		// Textures went away with bgfx
+		mRecords.clear();
+		mEvents.clear();
+		mEventIndex = 0;
+		mStarted = false;
+		mCursor = BGFX_INVALID_HANDLE;
+	}
+
+	void initRenderer()
+	{
+	}
+
+	void shutdownRenderer()
+	{
+	}
+
+	void beginRender()
+	{
+	}
+
+	void endRender()
+	{
+	}
+
+	const char* getName() const
+	{
+		return "replay";
+	}
+
+	DisplayMetrics getDisplayMetrics() { return mDisplayMetrics; }
+
+	unsigned int pollEvents(WindowEvent* events, unsigned int maxEvents)
+	{
+		if(mEventIndex >= mEvents.size()) { replayEvents(); }
+
+		unsigned int numEvents = std::min(
+			maxEvents, (unsigned int)mEvents.size() - mEventIndex
+		);
+		std::copy(
+			mEvents.begin() + mEventIndex,
+			mEvents.begin() + mEventIndex + numEvents,
+			events
+		);
+		mEventIndex += numEvents;
+
+		return numEvents;
+	}
+
+	void waitEvent(unsigned int timeoutMs)
+	{
+		// Nothing will come anymore
+		if(mNextRecord >= mRecords.size())
+		{
+			bx::sleep(timeoutMs);
+			return;
+		}
+
+		// The next batch is always due
+		if(mMaxSpeed) { return; }
+
+		int64_t now = bx::getHPCounter();
+		if(mNextRecordTime <= now) { return; }
+
+		int64_t wait = (mNextRecordTime - now) * 1000 / bx::getHPFrequency();
+		bx::sleep((uint32_t)std::min<int64_t>(wait, timeoutMs));
+	}
+
+	const WindowInfo* getWindowInfo(WindowId id)
+	{
+		auto itr = mWindows->find(id);
+		return itr != mWindows->end() ? &itr->second : NULL;
+	}
+
+	CursorInfo getCursorInfo()
+	{
+		CursorInfo cursorInfo;
+		cursorInfo.mTexture = mCursor;
+		cursorInfo.mOriginX = 0;
+		cursorInfo.mOriginY = 0;
+		cursorInfo.mWidth = gCursorSize;
+		cursorInfo.mHeight = gCursorSize;
+		return cursorInfo;
+	}
+
+private:
+	void replayEvents()
+	{
+		mEvents.clear();
+		mEventIndex = 0;
+
+		int64_t now = bx::getHPCounter();
+		int64_t frequency = bx::getHPFrequency();
+		if(!mStarted)
+		{
+			mCursor = createTexture(gCursorSize, gCursorSize, 0xffffffff);
+			mStartTime = now;
+			mNextRecordTime = now;
+			mStarted = true;
+		}
+
+		bool firstBatch = true;
+		while(mNextRecord < mRecords.size())
+		{
+			const WindowEventRecord& record = mRecords[mNextRecord];
+			bool batchStart = (record.mFlags & WindowEventRecord::BatchStart) != 0;
+			if(batchStart)
+			{
+				if(mMaxSpeed && !firstBatch) { break; }
+				if(!mMaxSpeed && mNextRecordTime > now) { break; }
+				firstBatch = false;
+			}
+
+			applyRecord(record, now);
+			++mNextRecord;
+
+			if(mNextRecord < mRecords.size())
+			{
+				// Whole seconds first, hours of microseconds times the
+				// counter frequency would overflow
+				int64_t deltaTime = (int64_t)mRecords[mNextRecord].mDeltaTime;
+				mNextRecordTime += deltaTime / 1000000 * frequency
+					+ deltaTime % 1000000 * frequency / 1000000;
+			}
+		}
+
+		if(mNextRecord >= mRecords.size() && !mFinished)
+		{
+			XVR_LOG(Info,
+				"Window event replay finished after ",
+				(double)(now - mStartTime) / (double)frequency, " s"
+			);
+			mFinished = true;
+		}
+	}
+
+	void applyRecord(const WindowEventRecord& record, int64_t time)
+	{
+		WindowEvent event;
+		memset(&event, 0, sizeof(event));
+		event.mWindow = record.mWindow;
+		event.mPID = record.mPID;
+		event.mType = (WindowEvent::Type)record.mType;
+		event.mChangedFields = record.mChangedFields;
+		event.mTime = time;
+
+		switch(event.mType)
+		{
+			case WindowEvent::WindowAdded:
+				{
+					// Only happens with truncated or concatenated recordings
+					if(mWindows->find(event.mWindow) != mWindows->end())
+					{
+						return;
+					}
+
+					WindowInfo& info = (*mWindows)[event.mWindow];
+					info.mPID = event.mPID;
+					applyGeometry(record, info);
+					info.mTexture = createTexture(
+						info.mWidth, info.mHeight, getColor(record.mWindow)
+					);
+				}
+				break;
+			case WindowEvent::WindowRemoved:
+				{
+					auto itr = mWindows->find(event.mWindow);
+					if(itr == mWindows->end()) { return; }
+
+					bgfx::destroyTexture(itr->second.mTexture);
+					mWindows->erase(itr);
+				}
+				break;
+			case WindowEvent::WindowUpdated:
+				{
+					auto itr = mWindows->find(event.mWindow);
+					if(itr == mWindows->end()) { return; }
+
+					WindowInfo& info = itr->second;
+					applyGeometry(record, info);
+					if(event.mChangedFields & WindowEvent::Texture)
+					{
+						bgfx::destroyTexture(info.mTexture);
+						info.mTexture = createTexture(
+							info.mWidth, info.mHeight, getColor(record.mWindow)
+						);
+					}
+					else if(event.mChangedFields & WindowEvent::Content)
+					{
+						updateTexture(info);
+					}
+				}
+				break;
+			default:
+				return;
+		}
+
+		if(event.mType != WindowEvent::WindowRemoved)
+		{
+			const WindowInfo& info = (*mWindows)[event.mWindow];
+			event.mX = info.mX;
+			event.mY = info.mY;
+			event.mWidth = info.mWidth;
+			event.mHeight = info.mHeight;
+			event.mInvertedY = info.mInvertedY;
+		}
+		mEvents.push_back(event);
+	}
+
+	void applyGeometry(const WindowEventRecord& record, WindowInfo& info)
+	{
+		info.mX = record.mX;
+		info.mY = record.mY;
+		info.mWidth = std::max<unsigned int>(record.mWidth, 1);
+		info.mHeight = std::max<unsigned int>(record.mHeight, 1);
+		info.mInvertedY = (record.mFlags & WindowEventRecord::InvertedY) != 0;
+	}
+
+	static uint32_t getColor(uint32_t window)
+	{
+		// Spreads neighbouring ids over different colors
+		return (window * 2654435761u) | 0xff000000;
+	}
+
+	bgfx::TextureHandle createTexture(
+		unsigned int width, unsigned int height, uint32_t color
+	)
+	{
+		const bgfx::Memory* mem = bgfx::alloc(width * height * 4);
+		uint32_t* pixels = reinterpret_cast<uint32_t*>(mem->data);
+		std::fill(pixels, pixels + width * height, color);
+
+		return bgfx::createTexture2D(
+			(uint16_t)width, (uint16_t)height, 1, bgfx::TextureFormat::BGRA8,
+			BGFX_TEXTURE_U_CLAMP | BGFX_TEXTURE_V_CLAMP, mem
+		);
+	}
+
+	// Same upload cost as a damaged band, the color flips every time
+	void updateTexture(const WindowInfo& info)
+	{
+		unsigned int numRows = std::min(gUpdateBandHeight, info.mHeight);
+		const bgfx::Memory* mem = bgfx::alloc(info.mWidth * numRows * 4);
+		uint32_t* pixels = reinterpret_cast<uint32_t*>(mem->data);
+		uint32_t color = getColor((uint32_t)mNextRecord);
+		std::fill(pixels, pixels + info.mWidth * numRows, color);
+
+		bgfx::updateTexture2D(
+			info.mTexture, 0,
+			0, 0, (uint16_t)info.mWidth, (uint16_t)numRows,
+			mem
+		);
+	}
+
+	WindowTable* mWindows;
+	DisplayMetrics mDisplayMetrics;
+	std::vector<WindowEventRecord> mRecords;
+	bool mMaxSpeed;
+	bool mStarted;
+	bool mFinished;
+	int64_t mStartTime;
+	size_t mNextRecord;
+	// When the next record is due at original speed
+	int64_t mNextRecordTime;
+	std::vector<WindowEvent> mEvents;
+	unsigned int mEventIndex;
+	bgfx::TextureHandle mCursor;
+};
+
+XVR_REGISTER(IWindowSystem, ReplayWindow)
+
+}
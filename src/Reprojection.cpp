@@ -0,0 +1,521 @@
+#include "Reprojection.hpp"
+#include <bx/platform.h>
+#include <bx/fpumath.h>
+#include <bx/timer.h>
+#include "IHMD.hpp"
+#include "LateLatch.hpp"
+#include "FrameScheduler.hpp"
+#include "Metrics.hpp"
+#include "Log.hpp"
+
+#if BX_PLATFORM_LINUX == 1
+#	include <GL/gl.h>
+#	include <GL/glext.h>
+#	include <GL/glx.h>
+#endif
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Fraction of a frame the main thread has left once the previous frame was
+// rendered, the rest is kept for presenting something else in time
+static const double gDeadline = 0.75;
+
+static Counter gReprojectedFramesMetric(
+	"xveearr_reprojected_frames_total",
+	"Frames presented by reprojection instead of the main thread"
+);
+
+#if BX_PLATFORM_LINUX == 1
+
+// Both eyes are side by side in the back buffer. Every pixel is turned into
+// a view ray, rotated into the view of the copied frame and projected back.
+// GLSL 1.40 works with both core and compatibility contexts.
+static const char* gVertexShader =
+	"#version 140\n"
+	"in vec2 a_position;\n"
+	"out vec2 v_uv;\n"
+	"void main()\n"
+	"{\n"
+	"	v_uv = a_position * 0.5 + 0.5;\n"
+	"	gl_Position = vec4(a_position, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* gFragmentShader =
+	"#version 140\n"
+	"uniform sampler2D u_frame;\n"
+	"uniform mat3 u_rotation;\n"
+	"uniform vec2 u_projScale;\n"
+	"in vec2 v_uv;\n"
+	"out vec4 o_color;\n"
+	"void main()\n"
+	"{\n"
+	"	float eye = step(0.5, v_uv.x);\n"
+	"	vec2 ndc = vec2(fract(v_uv.x * 2.0), v_uv.y) * 2.0 - 1.0;\n"
+	"	vec3 ray = u_rotation * vec3(ndc / u_projScale, -1.0);\n"
+	"	vec2 uv = u_projScale * ray.xy / -ray.z * 0.5 + 0.5;\n"
+	"	bool inside = ray.z < 0.0\n"
+	"		&& all(greaterThanEqual(uv, vec2(0.0)))\n"
+	"		&& all(lessThanEqual(uv, vec2(1.0)));\n"
+	"	o_color = inside\n"
+	"		? texture(u_frame, vec2((uv.x + eye) * 0.5, uv.y))\n"
+	"		: vec4(0.0, 0.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const GLuint gPositionLocation = 0;
+// Full screen quad as a triangle strip
+static const float gQuadVertices[] = {
+	-1.f, -1.f,
+	 1.f, -1.f,
+	-1.f,  1.f,
+	 1.f,  1.f
+};
+
+struct GLProcs
+{
+	PFNGLCREATESHADERPROC mCreateShader;
+	PFNGLSHADERSOURCEPROC mShaderSource;
+	PFNGLCOMPILESHADERPROC mCompileShader;
+	PFNGLGETSHADERIVPROC mGetShaderiv;
+	PFNGLDELETESHADERPROC mDeleteShader;
+	PFNGLCREATEPROGRAMPROC mCreateProgram;
+	PFNGLATTACHSHADERPROC mAttachShader;
+	PFNGLBINDATTRIBLOCATIONPROC mBindAttribLocation;
+	PFNGLBINDFRAGDATALOCATIONPROC mBindFragDataLocation;
+	PFNGLLINKPROGRAMPROC mLinkProgram;
+	PFNGLGETPROGRAMIVPROC mGetProgramiv;
+	PFNGLDELETEPROGRAMPROC mDeleteProgram;
+	PFNGLUSEPROGRAMPROC mUseProgram;
+	PFNGLGETUNIFORMLOCATIONPROC mGetUniformLocation;
+	PFNGLUNIFORM1IPROC mUniform1i;
+	PFNGLUNIFORM2FPROC mUniform2f;
+	PFNGLUNIFORMMATRIX3FVPROC mUniformMatrix3fv;
+	PFNGLACTIVETEXTUREPROC mActiveTexture;
+	PFNGLBINDFRAMEBUFFERPROC mBindFramebuffer;
+	PFNGLGENBUFFERSPROC mGenBuffers;
+	PFNGLBINDBUFFERPROC mBindBuffer;
+	PFNGLBUFFERDATAPROC mBufferData;
+	PFNGLDELETEBUFFERSPROC mDeleteBuffers;
+	PFNGLGENVERTEXARRAYSPROC mGenVertexArrays;
+	PFNGLBINDVERTEXARRAYPROC mBindVertexArray;
+	PFNGLDELETEVERTEXARRAYSPROC mDeleteVertexArrays;
+	PFNGLVERTEXATTRIBPOINTERPROC mVertexAttribPointer;
+	PFNGLENABLEVERTEXATTRIBARRAYPROC mEnableVertexAttribArray;
+};
+
+// Only touched by the render thread
+static GLProcs gGL;
+
+template<typename T>
+static bool loadProc(T& proc, const char* name)
+{
+	proc = (T)glXGetProcAddress((const GLubyte*)name);
+	return proc != NULL;
+}
+
+static GLuint compileShader(GLenum type, const char* source)
+{
+	GLuint shader = gGL.mCreateShader(type);
+	gGL.mShaderSource(shader, 1, &source, NULL);
+	gGL.mCompileShader(shader);
+
+	GLint compiled;
+	gGL.mGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if(!compiled)
+	{
+		gGL.mDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+#endif
+
+}
+
+Reprojection::Reprojection()
+	:mHMD(NULL)
+	,mLateLatch(NULL)
+	,mFrameScheduler(NULL)
+	,mWidth(0)
+	,mHeight(0)
+	,mProjScaleX(1.f)
+	,mProjScaleY(1.f)
+	,mEnabled(false)
+	,mArmed(false)
+	,mSubmittedFrames(0)
+	,mNumReprojectedFrames(0)
+	,mGLReady(false)
+	,mProgramFailed(false)
+	,mConsumedFrames(0)
+	,mPendingFlip(false)
+	,mMissed(false)
+	,mLastPresent(0)
+	,mProgram(0)
+	,mTexture(0)
+	,mVertexBuffer(0)
+	,mVertexArray(0)
+	,mRotationLocation(-1)
+	,mProjScaleLocation(-1)
+	,mFrameLocation(-1)
+	,mGpuTimer("gpu reprojection")
+{
+	bx::mtxIdentity(mFrameHeadTransform);
+}
+
+void Reprojection::init(
+	IHMD* hmd,
+	const LateLatch* lateLatch,
+	const FrameScheduler* frameScheduler
+)
+{
+	mHMD = hmd;
+	mLateLatch = lateLatch;
+	mFrameScheduler = frameScheduler;
+}
+
+void Reprojection::prepareResources(unsigned int width, unsigned int height)
+{
+	if(!mLateLatch->isEnabled())
+	{
+		XVR_LOG(Info, "Reprojection requires late latching");
+		return;
+	}
+
+	// Both eyes share the same symmetric projection
+	const float* proj = mHMD->getRenderData(Eye::Left).mViewProjection;
+	mProjScaleX = proj[0];
+	mProjScaleY = proj[5];
+	mWidth = width;
+	mHeight = height;
+	mEnabled = true;
+}
+
+void Reprojection::releaseResources()
+{
+	if(!mEnabled) { return; }
+
+	mEnabled = false;
+	mArmed = false;
+	mFrameSem.post();
+}
+
+bool Reprojection::isEnabled() const
+{
+	return mEnabled;
+}
+
+void Reprojection::setArmed(bool armed)
+{
+	mArmed = armed;
+}
+
+void Reprojection::frameSubmitted()
+{
+	if(!mEnabled) { return; }
+
+	++mSubmittedFrames;
+	mFrameSem.post();
+}
+
+unsigned int Reprojection::getNumReprojectedFrames() const
+{
+	return mNumReprojectedFrames;
+}
+
+void Reprojection::waitForFrame()
+{
+	mMissed = false;
+	// Nothing to present without a frame
+	if(!mGLReady || mLastPresent == 0) { return; }
+
+	int64_t frequency = bx::getHPFrequency();
+	int64_t frameInterval = mFrameScheduler->getFrameInterval();
+	int64_t deadline = mLastPresent + (int64_t)(frameInterval * gDeadline);
+	// Posts may outnumber frames after a missed deadline so the counter is
+	// what tells whether a frame is ready
+	while(mEnabled && mSubmittedFrames == mConsumedFrames)
+	{
+		if(!mArmed)
+		{
+			mFrameSem.wait();
+			continue;
+		}
+
+		int64_t now = bx::getHPCounter();
+		int32_t timeout = deadline > now
+			? (int32_t)((deadline - now) * 1000 / frequency)
+			: 0;
+		if(mFrameSem.wait(timeout)) { continue; }
+
+		// The frame bgfx would have flipped next is still current
+		if(mPendingFlip)
+		{
+			mPendingFlip = false;
+		}
+		else
+		{
+			draw();
+		}
+		present();
+		mMissed = true;
+		deadline = mLastPresent + (int64_t)(frameInterval * gDeadline);
+	}
+	mConsumedFrames = mSubmittedFrames;
+
+	// bgfx flips before rendering so the back buffer must hold something
+	// presentable again
+	if(mMissed && !mPendingFlip) { draw(); }
+}
+
+void Reprojection::initRenderer()
+{
+#if BX_PLATFORM_LINUX == 1
+	bool loaded = true
+		&& loadProc(gGL.mCreateShader, "glCreateShader")
+		&& loadProc(gGL.mShaderSource, "glShaderSource")
+		&& loadProc(gGL.mCompileShader, "glCompileShader")
+		&& loadProc(gGL.mGetShaderiv, "glGetShaderiv")
+		&& loadProc(gGL.mDeleteShader, "glDeleteShader")
+		&& loadProc(gGL.mCreateProgram, "glCreateProgram")
+		&& loadProc(gGL.mAttachShader, "glAttachShader")
+		&& loadProc(gGL.mBindAttribLocation, "glBindAttribLocation")
+		&& loadProc(gGL.mBindFragDataLocation, "glBindFragDataLocation")
+		&& loadProc(gGL.mLinkProgram, "glLinkProgram")
+		&& loadProc(gGL.mGetProgramiv, "glGetProgramiv")
+		&& loadProc(gGL.mDeleteProgram, "glDeleteProgram")
+		&& loadProc(gGL.mUseProgram, "glUseProgram")
+		&& loadProc(gGL.mGetUniformLocation, "glGetUniformLocation")
+		&& loadProc(gGL.mUniform1i, "glUniform1i")
+		&& loadProc(gGL.mUniform2f, "glUniform2f")
+		&& loadProc(gGL.mUniformMatrix3fv, "glUniformMatrix3fv")
+		&& loadProc(gGL.mActiveTexture, "glActiveTexture")
+		&& loadProc(gGL.mBindFramebuffer, "glBindFramebuffer")
+		&& loadProc(gGL.mGenBuffers, "glGenBuffers")
+		&& loadProc(gGL.mBindBuffer, "glBindBuffer")
+		&& loadProc(gGL.mBufferData, "glBufferData")
+		&& loadProc(gGL.mDeleteBuffers, "glDeleteBuffers")
+		&& loadProc(gGL.mGenVertexArrays, "glGenVertexArrays")
+		&& loadProc(gGL.mBindVertexArray, "glBindVertexArray")
+		&& loadProc(gGL.mDeleteVertexArrays, "glDeleteVertexArrays")
+		&& loadProc(gGL.mVertexAttribPointer, "glVertexAttribPointer")
+		&& loadProc(
+			gGL.mEnableVertexAttribArray, "glEnableVertexAttribArray"
+		);
+	if(!loaded) { XVR_LOG(Warn, "Reprojection requires OpenGL 3.1"); }
+	// The program is created once bgfx made its context current
+	mProgramFailed = !loaded;
+#endif
+}
+
+void Reprojection::shutdownRenderer()
+{
+	// Everything went away with bgfx's context
+	mGLReady = false;
+	mProgram = 0;
+	mTexture = 0;
+	mVertexBuffer = 0;
+	mVertexArray = 0;
+	mPendingFlip = false;
+	mLastPresent = 0;
+	mGpuTimer.shutdownRenderer();
+}
+
+void Reprojection::beginRender()
+{
+}
+
+void Reprojection::endRender()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(glXGetCurrentContext() == NULL) { return; }
+
+	if(!mEnabled)
+	{
+		releaseProgram();
+		mPendingFlip = false;
+		mLastPresent = 0;
+		return;
+	}
+
+	if(!mGLReady)
+	{
+		if(mProgramFailed) { return; }
+
+		mGLReady = initProgram();
+		mProgramFailed = !mGLReady;
+		if(!mGLReady) { return; }
+	}
+
+	mLastPresent = bx::getHPCounter();
+
+	mLateLatch->getHeadTransform(mFrameHeadTransform);
+	mGpuTimer.begin();
+	glBindTexture(GL_TEXTURE_2D, mTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, mWidth, mHeight);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	mGpuTimer.end();
+	mPendingFlip = true;
+#endif
+}
+
+bool Reprojection::initProgram()
+{
+#if BX_PLATFORM_LINUX == 1
+	GLuint vsh = compileShader(GL_VERTEX_SHADER, gVertexShader);
+	GLuint fsh = compileShader(GL_FRAGMENT_SHADER, gFragmentShader);
+	if(vsh == 0 || fsh == 0)
+	{
+		if(vsh != 0) { gGL.mDeleteShader(vsh); }
+		if(fsh != 0) { gGL.mDeleteShader(fsh); }
+		XVR_LOG(Error, "Could not compile reprojection shaders");
+		return false;
+	}
+
+	GLuint program = gGL.mCreateProgram();
+	gGL.mAttachShader(program, vsh);
+	gGL.mAttachShader(program, fsh);
+	gGL.mBindAttribLocation(program, gPositionLocation, "a_position");
+	gGL.mBindFragDataLocation(program, 0, "o_color");
+	gGL.mLinkProgram(program);
+	// Shaders are freed along with the program
+	gGL.mDeleteShader(vsh);
+	gGL.mDeleteShader(fsh);
+
+	GLint linked;
+	gGL.mGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if(!linked)
+	{
+		gGL.mDeleteProgram(program);
+		XVR_LOG(Error, "Could not link reprojection program");
+		return false;
+	}
+
+	mProgram = program;
+	mRotationLocation = gGL.mGetUniformLocation(program, "u_rotation");
+	mProjScaleLocation = gGL.mGetUniformLocation(program, "u_projScale");
+	mFrameLocation = gGL.mGetUniformLocation(program, "u_frame");
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_RGBA8, mWidth, mHeight, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, NULL
+	);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	mTexture = texture;
+
+	// bgfx keeps its own vertex array bound
+	GLint prevVertexArray;
+	GLint prevBuffer;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prevVertexArray);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &prevBuffer);
+	gGL.mGenVertexArrays(1, &mVertexArray);
+	gGL.mBindVertexArray(mVertexArray);
+	gGL.mGenBuffers(1, &mVertexBuffer);
+	gGL.mBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	gGL.mBufferData(
+		GL_ARRAY_BUFFER, sizeof(gQuadVertices), gQuadVertices, GL_STATIC_DRAW
+	);
+	gGL.mEnableVertexAttribArray(gPositionLocation);
+	gGL.mVertexAttribPointer(gPositionLocation, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+	gGL.mBindVertexArray(prevVertexArray);
+	gGL.mBindBuffer(GL_ARRAY_BUFFER, prevBuffer);
+
+	XVR_LOG(Debug, "Reprojection program ready");
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Reprojection::releaseProgram()
+{
+#if BX_PLATFORM_LINUX == 1
+	if(!mGLReady) { return; }
+
+	gGL.mDeleteProgram(mProgram);
+	glDeleteTextures(1, &mTexture);
+	gGL.mDeleteBuffers(1, &mVertexBuffer);
+	gGL.mDeleteVertexArrays(1, &mVertexArray);
+	mProgram = 0;
+	mTexture = 0;
+	mVertexBuffer = 0;
+	mVertexArray = 0;
+	mGLReady = false;
+#endif
+}
+
+void Reprojection::draw()
+{
+#if BX_PLATFORM_LINUX == 1
+	float headTransform[16];
+	mHMD->getPredictedHeadTransform(
+		bx::getHPCounter() + mFrameScheduler->getFrameInterval(), headTransform
+	);
+
+	// ray * head * inverse(frameHead), rotation only. Rows of the row-vector
+	// matrix become columns of the GLSL one.
+	float rotation[9];
+	for(int row = 0; row < 3; ++row)
+	{
+		for(int col = 0; col < 3; ++col)
+		{
+			rotation[row * 3 + col] =
+				headTransform[row * 4 + 0] * mFrameHeadTransform[col * 4 + 0]
+				+ headTransform[row * 4 + 1] * mFrameHeadTransform[col * 4 + 1]
+				+ headTransform[row * 4 + 2] * mFrameHeadTransform[col * 4 + 2];
+		}
+	}
+
+	mGpuTimer.begin();
+	// bgfx sets the state it needs for every draw but assumes these are off
+	gGL.mBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, mWidth, mHeight);
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glDisable(GL_CULL_FACE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	gGL.mUseProgram(mProgram);
+	gGL.mUniformMatrix3fv(mRotationLocation, 1, GL_FALSE, rotation);
+	gGL.mUniform2f(mProjScaleLocation, mProjScaleX, mProjScaleY);
+	gGL.mUniform1i(mFrameLocation, 0);
+	gGL.mActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mTexture);
+
+	GLint prevVertexArray;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prevVertexArray);
+	gGL.mBindVertexArray(mVertexArray);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	gGL.mBindVertexArray(prevVertexArray);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gGL.mUseProgram(0);
+	mGpuTimer.end();
+
+	++mNumReprojectedFrames;
+	gReprojectedFramesMetric.add();
+#endif
+}
+
+void Reprojection::present()
+{
+#if BX_PLATFORM_LINUX == 1
+	// Blocks until vsync like bgfx's own flip
+	glXSwapBuffers(glXGetCurrentDisplay(), glXGetCurrentDrawable());
+	mLastPresent = bx::getHPCounter();
+#endif
+}
+
+}
@@ -0,0 +1,93 @@
+#ifndef XVEEARR_REPROJECTION_HPP
+#define XVEEARR_REPROJECTION_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <bx/sem.h>
+#include "IRenderHook.hpp"
+#include "GpuTimer.hpp"
+
+namespace xveearr
+{
+
+class IHMD;
+class LateLatch;
+class FrameScheduler;
+
+// Keeps the display fed when the main thread misses a frame. The render
+// thread waits for the main thread's submission with a deadline and, when
+// it passes, presents a copy of the last frame rotated to the latest head
+// pose. Requires late latching since the pose of the copied frame must be
+// known.
+class Reprojection: public IRenderHook
+{
+public:
+	Reprojection();
+
+	void init(
+		IHMD* hmd,
+		const LateLatch* lateLatch,
+		const FrameScheduler* frameScheduler
+	);
+
+	// Main thread, after bgfx and late latching are ready
+	void prepareResources(unsigned int width, unsigned int height);
+	// Must be called before bgfx::shutdown or the render thread would never
+	// reach bgfx::renderFrame
+	void releaseResources();
+	bool isEnabled() const;
+	// Frames are expected every vsync, otherwise the render thread just
+	// waits for the next one
+	void setArmed(bool armed);
+	// Right before bgfx::frame
+	void frameSubmitted();
+	unsigned int getNumReprojectedFrames() const;
+
+	// Render thread, before any other render hook
+	void waitForFrame();
+
+	void initRenderer();
+	void shutdownRenderer();
+	void beginRender();
+	void endRender();
+
+private:
+	bool initProgram();
+	void releaseProgram();
+	void draw();
+	void present();
+
+	IHMD* mHMD;
+	const LateLatch* mLateLatch;
+	const FrameScheduler* mFrameScheduler;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	float mProjScaleX;
+	float mProjScaleY;
+	std::atomic<bool> mEnabled;
+	std::atomic<bool> mArmed;
+	std::atomic<unsigned int> mSubmittedFrames;
+	std::atomic<unsigned int> mNumReprojectedFrames;
+	bx::Semaphore mFrameSem;
+	// Render thread only
+	bool mGLReady;
+	bool mProgramFailed;
+	unsigned int mConsumedFrames;
+	// The back buffer holds a frame bgfx has not flipped yet
+	bool mPendingFlip;
+	bool mMissed;
+	int64_t mLastPresent;
+	float mFrameHeadTransform[16];
+	uint32_t mProgram;
+	uint32_t mTexture;
+	uint32_t mVertexBuffer;
+	uint32_t mVertexArray;
+	int mRotationLocation;
+	int mProjScaleLocation;
+	int mFrameLocation;
+	GpuTimer mGpuTimer;
+};
+
+}
+
+#endif
@@ -0,0 +1,588 @@
+#include "IWindowSystem.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <bx/bx.h>
+#include <bx/commandline.h>
+#include <bx/os.h>
+#include <bx/rng.h>
+#include <bx/timer.h>
+#include "Registry.hpp"
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const unsigned int gDefaultNumWindows = 100;
+static const unsigned int gDefaultNumGroups = 10;
+// Exponent of zipf when none is given, group k gets 1/k^s of the windows
+static const double gDefaultZipfExponent = 1.0;
+static const unsigned int gDefaultMinWidth = 160;
+static const unsigned int gDefaultMinHeight = 120;
+static const unsigned int gDefaultMaxWidth = 640;
+static const unsigned int gDefaultMaxHeight = 480;
+// Events per second over all windows
+static const double gDefaultChurnRate = 0.0;
+static const double gDefaultResizeRate = 0.0;
+static const double gDefaultUpdateRate = 100.0;
+// Rows rewritten by a content update, like a damaged region
+static const unsigned int gUpdateBandHeight = 32;
+// Events are not made up for stalls longer than this (in seconds)
+static const double gMaxCatchUpTime = 0.25;
+static const unsigned int gCursorSize = 16;
+static const DisplayMetrics gDisplayMetrics = { 1920, 1080, 0.53f, 0.30f };
+
+// In seconds, pending is the fraction of an event already accumulated
+double getTimeToNextEvent(double pending, double rate)
+{
+	return rate > 0.0 ? (1.0 - pending) / rate : gMaxCatchUpTime;
+}
+
+bool parseSize(const char* str, unsigned int& width, unsigned int& height)
+{
+	return sscanf(str, "%ux%u", &width, &height) == 2
+		&& width > 0 && height > 0;
+}
+
+struct GroupDistribution
+{
+	enum Enum
+	{
+		RoundRobin,
+		Uniform,
+		Zipf,
+
+		Count
+	};
+};
+
+bool parseGroupDistribution(
+	const char* str, GroupDistribution::Enum& distribution, double& exponent
+)
+{
+	exponent = gDefaultZipfExponent;
+	if(strcmp(str, "round-robin") == 0)
+	{
+		distribution = GroupDistribution::RoundRobin;
+		return true;
+	}
+	else if(strcmp(str, "uniform") == 0)
+	{
+		distribution = GroupDistribution::Uniform;
+		return true;
+	}
+	else if(strcmp(str, "zipf") == 0)
+	{
+		distribution = GroupDistribution::Zipf;
+		return true;
+	}
+	else if(sscanf(str, "zipf:%lf", &exponent) == 1 && exponent >= 0.0)
+	{
+		distribution = GroupDistribution::Zipf;
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+}
+
+// Made up windows for load testing without an X server. Windows are mapped,
+// unmapped, resized and redrawn at configurable rates and their contents
+// are procedural textures uploaded with bgfx::updateTexture2D, so it works
+// with any bgfx renderer including the null one.
+class SyntheticWindow: public IWindowSystem
+{
+public:
+	SyntheticWindow()
+		:mWindows(NULL)
+		,mNumGroups(gDefaultNumGroups)
+		,mMinWidth(gDefaultMinWidth)
+		,mMinHeight(gDefaultMinHeight)
+		,mMaxWidth(gDefaultMaxWidth)
+		,mMaxHeight(gDefaultMaxHeight)
+		,mChurnRate(gDefaultChurnRate)
+		,mResizeRate(gDefaultResizeRate)
+		,mUpdateRate(gDefaultUpdateRate)
+		,mPendingChurns(0.0)
+		,mPendingResizes(0.0)
+		,mPendingUpdates(0.0)
+		,mStarted(false)
+		,mLastUpdate(0)
+		,mEventIndex(0)
+	{
+		mCursor = BGFX_INVALID_HANDLE;
+	}
+
+	bool probe()
+	{
+		return true;
+	}
+
+	bool isSynthetic() const
+	{
+		return true;
+	}
+
+	bool init(const WindowSystemCfg& cfg)
+	{
+		mWindows = cfg.mWindowTable;
+
+		const bx::CommandLine& cmdLine = *cfg.mCmdLine;
+		unsigned int numWindows = gDefaultNumWindows;
+		const char* numWindowsStr = cmdLine.findOption("synthetic-windows");
+		if(numWindowsStr) { numWindows = (unsigned int)atoi(numWindowsStr); }
+
+		const char* numGroupsStr = cmdLine.findOption("synthetic-groups");
+		if(numGroupsStr) { mNumGroups = (unsigned int)atoi(numGroupsStr); }
+		XVR_ENSURE(mNumGroups > 0, "Invalid number of groups: ", numGroupsStr);
+
+		const char* distributionStr = cmdLine.findOption(
+			"synthetic-distribution", "round-robin"
+		);
+		GroupDistribution::Enum distribution;
+		double exponent;
+		XVR_ENSURE(
+			parseGroupDistribution(distributionStr, distribution, exponent),
+			"Invalid group distribution: ", distributionStr
+		);
+
+		const char* minSizeStr = cmdLine.findOption("synthetic-min-size");
+		XVR_ENSURE(
+			!minSizeStr || parseSize(minSizeStr, mMinWidth, mMinHeight),
+			"Invalid window size: ", minSizeStr
+		);
+		const char* maxSizeStr = cmdLine.findOption("synthetic-max-size");
+		XVR_ENSURE(
+			!maxSizeStr || parseSize(maxSizeStr, mMaxWidth, mMaxHeight),
+			"Invalid window size: ", maxSizeStr
+		);
+		mMaxWidth = std::min(
+			std::max(mMaxWidth, mMinWidth), gDisplayMetrics.mWidthInPixels
+		);
+		mMaxHeight = std::min(
+			std::max(mMaxHeight, mMinHeight), gDisplayMetrics.mHeightInPixels
+		);
+		mMinWidth = std::min(mMinWidth, mMaxWidth);
+		mMinHeight = std::min(mMinHeight, mMaxHeight);
+
+		const char* churnRateStr = cmdLine.findOption("synthetic-churn-rate");
+		if(churnRateStr) { mChurnRate = atof(churnRateStr); }
+		const char* resizeRateStr = cmdLine.findOption("synthetic-resize-rate");
+		if(resizeRateStr) { mResizeRate = atof(resizeRateStr); }
+		const char* updateRateStr = cmdLine.findOption("synthetic-update-rate");
+		if(updateRateStr) { mUpdateRate = atof(updateRateStr); }
+
+		uint32_t seed = 1;
+		const char* seedStr = cmdLine.findOption("synthetic-seed");
+		if(seedStr) { seed = (uint32_t)strtoul(seedStr, NULL, 10); }
+		mRng.reset(seed, seed ^ 0x9e3779b9);
+
+		// Cumulative share of each group for zipf
+		std::vector<double> groupWeights;
+		if(distribution == GroupDistribution::Zipf)
+		{
+			double total = 0.0;
+			groupWeights.resize(mNumGroups);
+			for(unsigned int i = 0; i < mNumGroups; ++i)
+			{
+				total += 1.0 / pow((double)(i + 1), exponent);
+				groupWeights[i] = total;
+			}
+		}
+
+		mWindowStates.resize(numWindows);
+		mMappedWindows.reserve(numWindows);
+		for(unsigned int i = 0; i < numWindows; ++i)
+		{
+			Window& window = mWindowStates[i];
+			window.mId = i + 1;
+			window.mPID = 1 + pickGroup(distribution, i, groupWeights);
+			window.mMapped = false;
+			window.mMappedIndex = 0;
+			window.mPhase = 0;
+			window.mColor = mRng.gen() | 0xff000000;
+		}
+
+		XVR_LOG(Info,
+			"Synthetic windows: ", numWindows, " in ", mNumGroups, " group(s) (",
+			distributionStr, "), ",
+			mChurnRate, " map/unmap, ", mResizeRate, " resize and ",
+			mUpdateRate, " update(s) per second"
+		);
+
+		return true;
+	}
+
+	void shutdown()
+	{
+		// Textures went away with bgfx
+		mWindowStates.clear();
+		mMappedWindows.clear();
+		mEvents.clear();
+		mEventIndex = 0;
+		mStarted = false;
+		mCursor = BGFX_INVALID_HANDLE;
+	}
+
+	void initRenderer()
+	{
+	}
+
+	void shutdownRenderer()
+	{
+	}
+
+	void beginRender()
+	{
+	}
+
+	void endRender()
+	{
+	}
+
+	const char* getName() const
+	{
+		return "synthetic";
+	}
+
+	DisplayMetrics getDisplayMetrics() { return gDisplayMetrics; }
+
+	unsigned int pollEvents(WindowEvent* events, unsigned int maxEvents)
+	{
+		if(mEventIndex >= mEvents.size()) { generateEvents(); }
+
+		unsigned int numEvents = std::min(
+			maxEvents, (unsigned int)mEvents.size() - mEventIndex
+		);
+		std::copy(
+			mEvents.begin() + mEventIndex,
+			mEvents.begin() + mEventIndex + numEvents,
+			events
+		);
+		mEventIndex += numEvents;
+
+		return numEvents;
+	}
+
+	void waitEvent(unsigned int timeoutMs)
+	{
+		// Until the next event is due
+		double waitTime = std::min(
+			getTimeToNextEvent(mPendingChurns, mChurnRate),
+			std::min(
+				getTimeToNextEvent(mPendingResizes, mResizeRate),
+				getTimeToNextEvent(mPendingUpdates, mUpdateRate)
+			)
+		);
+		timeoutMs = std::min(timeoutMs, (unsigned int)(waitTime * 1000.0));
+
+		if(timeoutMs > 0) { bx::sleep(timeoutMs); }
+	}
+
+	const WindowInfo* getWindowInfo(WindowId id)
+	{
+		auto itr = mWindows->find(id);
+		return itr != mWindows->end() ? &itr->second : NULL;
+	}
+
+	CursorInfo getCursorInfo()
+	{
+		CursorInfo cursorInfo;
+		cursorInfo.mTexture = mCursor;
+		cursorInfo.mOriginX = 0;
+		cursorInfo.mOriginY = 0;
+		cursorInfo.mWidth = gCursorSize;
+		cursorInfo.mHeight = gCursorSize;
+		return cursorInfo;
+	}
+
+private:
+	struct Window
+	{
+		WindowId mId;
+		PID mPID;
+		bool mMapped;
+		// Position in mMappedWindows
+		unsigned int mMappedIndex;
+		unsigned int mPhase;
+		uint32_t mColor;
+	};
+
+	void generateEvents()
+	{
+		mEvents.clear();
+		mEventIndex = 0;
+
+		int64_t now = bx::getHPCounter();
+		if(!mStarted)
+		{
+			mLastUpdate = now;
+			createCursor();
+			for(Window& window: mWindowStates) { mapWindow(window); }
+			mStarted = true;
+			return;
+		}
+
+		double dt = (double)(now - mLastUpdate) / (double)bx::getHPFrequency();
+		dt = std::min(dt, gMaxCatchUpTime);
+		mLastUpdate = now;
+		if(mWindowStates.empty()) { return; }
+
+		mPendingChurns += mChurnRate * dt;
+		for(; mPendingChurns >= 1.0; mPendingChurns -= 1.0)
+		{
+			Window& window = pickWindow();
+			if(window.mMapped)
+			{
+				unmapWindow(window);
+			}
+			else
+			{
+				mapWindow(window);
+			}
+		}
+
+		mPendingResizes += mResizeRate * dt;
+		for(; mPendingResizes >= 1.0; mPendingResizes -= 1.0)
+		{
+			if(mMappedWindows.empty()) { continue; }
+			resizeWindow(pickMappedWindow());
+		}
+
+		mPendingUpdates += mUpdateRate * dt;
+		for(; mPendingUpdates >= 1.0; mPendingUpdates -= 1.0)
+		{
+			if(mMappedWindows.empty()) { continue; }
+			updateWindow(pickMappedWindow());
+		}
+	}
+
+	Window& pickWindow()
+	{
+		return mWindowStates[mRng.gen() % mWindowStates.size()];
+	}
+
+	// Resizes and updates only apply to mapped windows, picking among all
+	// of them would fall short of the configured rates
+	Window& pickMappedWindow()
+	{
+		unsigned int index = mMappedWindows[mRng.gen() % mMappedWindows.size()];
+		return mWindowStates[index];
+	}
+
+	void mapWindow(Window& window)
+	{
+		WindowInfo& info = (*mWindows)[window.mId];
+		info.mPID = window.mPID;
+		info.mInvertedY = true;
+		randomizeGeometry(info);
+		info.mTexture = createContent(window, info.mWidth, info.mHeight);
+		window.mMapped = true;
+		window.mMappedIndex = (unsigned int)mMappedWindows.size();
+		mMappedWindows.push_back(
+			(unsigned int)(&window - mWindowStates.data())
+		);
+
+		pushEvent(window, WindowEvent::WindowAdded, 0);
+	}
+
+	void unmapWindow(Window& window)
+	{
+		auto itr = mWindows->find(window.mId);
+		if(itr != mWindows->end())
+		{
+			bgfx::destroyTexture(itr->second.mTexture);
+			mWindows->erase(itr);
+		}
+		window.mMapped = false;
+
+		// Swaps the last mapped window into the freed slot
+		unsigned int last = mMappedWindows.back();
+		mMappedWindows[window.mMappedIndex] = last;
+		mWindowStates[last].mMappedIndex = window.mMappedIndex;
+		mMappedWindows.pop_back();
+
+		pushEvent(window, WindowEvent::WindowRemoved, 0);
+	}
+
+	void resizeWindow(Window& window)
+	{
+		WindowInfo& info = (*mWindows)[window.mId];
+		bgfx::destroyTexture(info.mTexture);
+		randomizeGeometry(info);
+		info.mTexture = createContent(window, info.mWidth, info.mHeight);
+
+		pushEvent(
+			window, WindowEvent::WindowUpdated,
+			WindowEvent::Position | WindowEvent::Size
+			| WindowEvent::Texture | WindowEvent::Content
+		);
+	}
+
+	void updateWindow(Window& window)
+	{
+		const WindowInfo& info = (*mWindows)[window.mId];
+		unsigned int numRows = std::min(gUpdateBandHeight, info.mHeight);
+		unsigned int firstRow =
+			(window.mPhase * gUpdateBandHeight) % (info.mHeight - numRows + 1);
+		++window.mPhase;
+
+		const bgfx::Memory* mem = bgfx::alloc(info.mWidth * numRows * 4);
+		fillContent(window, mem->data, info.mWidth, firstRow, numRows);
+		bgfx::updateTexture2D(
+			info.mTexture, 0,
+			0, (uint16_t)firstRow, (uint16_t)info.mWidth, (uint16_t)numRows,
+			mem
+		);
+
+		pushEvent(window, WindowEvent::WindowUpdated, WindowEvent::Content);
+	}
+
+	void randomizeGeometry(WindowInfo& info)
+	{
+		info.mWidth =
+			mMinWidth + mRng.gen() % (mMaxWidth - mMinWidth + 1);
+		info.mHeight =
+			mMinHeight + mRng.gen() % (mMaxHeight - mMinHeight + 1);
+		info.mX = (int)(
+			mRng.gen() % (gDisplayMetrics.mWidthInPixels - info.mWidth + 1)
+		);
+		info.mY = (int)(
+			mRng.gen() % (gDisplayMetrics.mHeightInPixels - info.mHeight + 1)
+		);
+	}
+
+	bgfx::TextureHandle createContent(
+		Window& window, unsigned int width, unsigned int height
+	)
+	{
+		const bgfx::Memory* mem = bgfx::alloc(width * height * 4);
+		fillContent(window, mem->data, width, 0, height);
+
+		return bgfx::createTexture2D(
+			(uint16_t)width, (uint16_t)height, 1, bgfx::TextureFormat::BGRA8,
+			BGFX_TEXTURE_U_CLAMP | BGFX_TEXTURE_V_CLAMP, mem
+		);
+	}
+
+	// Diagonal stripes over the window's color which move with every update
+	void fillContent(
+		const Window& window, uint8_t* data,
+		unsigned int width, unsigned int firstRow, unsigned int numRows
+	)
+	{
+		uint32_t* pixels = reinterpret_cast<uint32_t*>(data);
+		for(unsigned int y = 0; y < numRows; ++y)
+		{
+			for(unsigned int x = 0; x < width; ++x)
+			{
+				unsigned int stripe = (x + firstRow + y + window.mPhase * 4) & 0x10;
+				pixels[y * width + x] = stripe
+					? window.mColor
+					: window.mColor ^ 0x00606060;
+			}
+		}
+	}
+
+	void createCursor()
+	{
+		const bgfx::Memory* mem = bgfx::alloc(gCursorSize * gCursorSize * 4);
+		uint32_t* pixels = reinterpret_cast<uint32_t*>(mem->data);
+		// An arrow-ish triangle
+		for(unsigned int y = 0; y < gCursorSize; ++y)
+		{
+			for(unsigned int x = 0; x < gCursorSize; ++x)
+			{
+				pixels[y * gCursorSize + x] = x <= y ? 0xffffffff : 0;
+			}
+		}
+
+		mCursor = bgfx::createTexture2D(
+			gCursorSize, gCursorSize, 1, bgfx::TextureFormat::BGRA8,
+			BGFX_TEXTURE_U_CLAMP | BGFX_TEXTURE_V_CLAMP, mem
+		);
+	}
+
+	void pushEvent(
+		const Window& window, WindowEvent::Type type, uint32_t changedFields
+	)
+	{
+		WindowEvent event;
+		memset(&event, 0, sizeof(event));
+		event.mWindow = window.mId;
+		event.mPID = window.mPID;
+		event.mType = type;
+		event.mChangedFields = changedFields;
+		event.mTime = mLastUpdate;
+		if(window.mMapped)
+		{
+			const WindowInfo& info = (*mWindows)[window.mId];
+			event.mX = info.mX;
+			event.mY = info.mY;
+			event.mWidth = info.mWidth;
+			event.mHeight = info.mHeight;
+			event.mInvertedY = info.mInvertedY;
+		}
+		mEvents.push_back(event);
+	}
+
+	unsigned int pickGroup(
+		GroupDistribution::Enum distribution,
+		unsigned int index,
+		const std::vector<double>& groupWeights
+	)
+	{
+		switch(distribution)
+		{
+			case GroupDistribution::Uniform:
+				return mRng.gen() % mNumGroups;
+			case GroupDistribution::Zipf:
+				{
+					double value =
+						mRng.gen() / 4294967296.0 * groupWeights.back();
+					unsigned int group = (unsigned int)(std::upper_bound(
+						groupWeights.begin(), groupWeights.end(), value
+					) - groupWeights.begin());
+					// Rounding can put the value past the last weight
+					return std::min(group, mNumGroups - 1);
+				}
+			default:
+				return index % mNumGroups;
+		}
+	}
+
+	WindowTable* mWindows;
+	unsigned int mNumGroups;
+	unsigned int mMinWidth;
+	unsigned int mMinHeight;
+	unsigned int mMaxWidth;
+	unsigned int mMaxHeight;
+	double mChurnRate;
+	double mResizeRate;
+	double mUpdateRate;
+	double mPendingChurns;
+	double mPendingResizes;
+	double mPendingUpdates;
+	bool mStarted;
+	int64_t mLastUpdate;
+	bx::RngMwc mRng;
+	std::vector<Window> mWindowStates;
+	// Indices into mWindowStates
+	std::vector<unsigned int> mMappedWindows;
+	std::vector<WindowEvent> mEvents;
+	unsigned int mEventIndex;
+	bgfx::TextureHandle mCursor;
+};
+
+XVR_REGISTER(IWindowSystem, SyntheticWindow)
+
+}
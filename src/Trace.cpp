@@ -0,0 +1,201 @@
+#include "Trace.hpp"
+#include <cstdio>
+#include <bx/bx.h>
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+// Power of two, each thread keeps its most recent events
+static const unsigned int gMaxEventsPerThread = 1 << 17;
+
+// Atomic so flush can read a slot while its thread overwrites it, torn
+// events are detected and skipped
+struct TraceEvent
+{
+	std::atomic<const char*> mName;
+	std::atomic<int64_t> mStart;
+	std::atomic<int64_t> mEnd;
+};
+
+struct ThreadBuffer
+{
+	ThreadBuffer* mNext;
+	unsigned int mThreadId;
+	const char* mName;
+	// Events ever recorded, written by the owning thread, read by flush
+	std::atomic<uint64_t> mNumEvents;
+	TraceEvent mEvents[gMaxEventsPerThread];
+};
+
+static std::atomic<ThreadBuffer*> gBuffers(NULL);
+static std::atomic<unsigned int> gNextThreadId(1);
+static const char* gPath = NULL;
+static int64_t gStartTime = 0;
+thread_local ThreadBuffer* tBuffer = NULL;
+thread_local const char* tThreadName = NULL;
+
+ThreadBuffer* getThreadBuffer()
+{
+	if(tBuffer != NULL) { return tBuffer; }
+
+	ThreadBuffer* buffer = new ThreadBuffer;
+	buffer->mThreadId = gNextThreadId.fetch_add(1, std::memory_order_relaxed);
+	buffer->mName = tThreadName;
+	buffer->mNumEvents.store(0, std::memory_order_relaxed);
+
+	// Lock-free push to the front of the list
+	buffer->mNext = gBuffers.load(std::memory_order_relaxed);
+	while(!gBuffers.compare_exchange_weak(
+		buffer->mNext, buffer,
+		std::memory_order_release, std::memory_order_relaxed
+	))
+	{}
+
+	tBuffer = buffer;
+	return buffer;
+}
+
+double toMicroseconds(int64_t ticks)
+{
+	return (double)ticks * 1000000.0 / (double)bx::getHPFrequency();
+}
+
+}
+
+std::atomic<bool> Trace::sEnabled(false);
+
+bool Trace::init(const char* path)
+{
+	// Fail early rather than after a long session
+	FILE* file = fopen(path, "w");
+	XVR_ENSURE(file != NULL, "Could not open ", path, " for writing");
+	fclose(file);
+
+	gPath = path;
+	gStartTime = bx::getHPCounter();
+	sEnabled.store(true, std::memory_order_relaxed);
+	XVR_LOG(Info, "Tracing to ", path);
+
+	return true;
+}
+
+bool Trace::flush()
+{
+	if(!isEnabled()) { return false; }
+
+	FILE* file = fopen(gPath, "w");
+	XVR_ENSURE(file != NULL, "Could not open ", gPath, " for writing");
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	uint64_t numEvents = 0;
+	uint64_t numOverwritten = 0;
+	for(
+		ThreadBuffer* buffer = gBuffers.load(std::memory_order_acquire);
+		buffer != NULL;
+		buffer = buffer->mNext
+	)
+	{
+		if(buffer->mName != NULL)
+		{
+			fprintf(file,
+				"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+				"\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", buffer->mThreadId, buffer->mName
+			);
+			first = false;
+		}
+
+		// Events past this count may still be written to
+		uint64_t count = buffer->mNumEvents.load(std::memory_order_acquire);
+		uint64_t begin =
+			count > gMaxEventsPerThread ? count - gMaxEventsPerThread : 0;
+		for(uint64_t i = begin; i < count; ++i)
+		{
+			const TraceEvent& slot = buffer->mEvents[i & (gMaxEventsPerThread - 1)];
+			const char* name = slot.mName.load(std::memory_order_relaxed);
+			int64_t start = slot.mStart.load(std::memory_order_relaxed);
+			int64_t end = slot.mEnd.load(std::memory_order_relaxed);
+
+			// The thread may have wrapped around onto this slot meanwhile
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t latest = buffer->mNumEvents.load(std::memory_order_relaxed);
+			if(latest >= i + gMaxEventsPerThread)
+			{
+				++numOverwritten;
+				continue;
+			}
+
+			fprintf(file,
+				"%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+				"\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n", name, buffer->mThreadId,
+				toMicroseconds(start - gStartTime),
+				toMicroseconds(end - start)
+			);
+			first = false;
+			++numEvents;
+		}
+
+		numOverwritten += begin;
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+
+	XVR_LOG(Info, "Wrote ", numEvents, " trace event(s) to ", gPath);
+	if(numOverwritten > 0)
+	{
+		XVR_LOG(Warn,
+			numOverwritten, " older trace event(s) overwritten, only the last ",
+			gMaxEventsPerThread, " per thread are kept"
+		);
+	}
+
+	return true;
+}
+
+void Trace::shutdown()
+{
+	if(!isEnabled()) { return; }
+
+	flush();
+	sEnabled.store(false, std::memory_order_relaxed);
+
+	ThreadBuffer* buffer = gBuffers.exchange(NULL, std::memory_order_acquire);
+	while(buffer != NULL)
+	{
+		ThreadBuffer* next = buffer->mNext;
+		delete buffer;
+		buffer = next;
+	}
+	// Only valid for the calling thread, the others are gone
+	tBuffer = NULL;
+}
+
+void Trace::setThreadName(const char* name)
+{
+	tThreadName = name;
+	if(tBuffer != NULL) { tBuffer->mName = name; }
+}
+
+void Trace::addEvent(const char* name, int64_t start, int64_t end)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+	uint64_t index = buffer->mNumEvents.load(std::memory_order_relaxed);
+
+	// Orders the previous count before the slot is overwritten, which lets
+	// flush detect a torn read
+	std::atomic_thread_fence(std::memory_order_release);
+	TraceEvent& slot = buffer->mEvents[index & (gMaxEventsPerThread - 1)];
+	slot.mName.store(name, std::memory_order_relaxed);
+	slot.mStart.store(start, std::memory_order_relaxed);
+	slot.mEnd.store(end, std::memory_order_relaxed);
+	// Publishes the event to flush
+	buffer->mNumEvents.store(index + 1, std::memory_order_release);
+}
+
+}
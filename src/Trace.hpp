@@ -0,0 +1,69 @@
+#ifndef XVEEARR_TRACE_HPP
+#define XVEEARR_TRACE_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <bx/macros.h>
+#include <bx/timer.h>
+
+// Records the enclosing scope as a trace event. NAME must outlive the
+// trace, string literals are fine.
+#define XVR_TRACE_SCOPE(NAME) \
+	::xveearr::TraceScope BX_CONCATENATE(xvrTraceScope, __LINE__)(NAME)
+
+namespace xveearr
+{
+
+// Timeline of scopes on every thread, written as a Chrome trace event file
+// (chrome://tracing). Each thread records into its own buffer without
+// locking into a ring that keeps its most recent events, the buffers are
+// only allocated once tracing is enabled.
+class Trace
+{
+public:
+	// Before any thread records
+	static bool init(const char* path);
+	// Writes everything recorded so far, can be called again later. Main
+	// thread only.
+	static bool flush();
+	// Flushes, must be called after the other threads stopped recording
+	static void shutdown();
+
+	static bool isEnabled()
+	{
+		return sEnabled.load(std::memory_order_relaxed);
+	}
+
+	// Shown as the calling thread's name, can be called before init
+	static void setThreadName(const char* name);
+	// Times are bx::getHPCounter ticks
+	static void addEvent(const char* name, int64_t start, int64_t end);
+
+private:
+	static std::atomic<bool> sEnabled;
+};
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name)
+		:mName(name)
+		,mStart(Trace::isEnabled() ? bx::getHPCounter() : 0)
+	{}
+
+	~TraceScope()
+	{
+		if(mStart != 0)
+		{
+			Trace::addEvent(mName, mStart, bx::getHPCounter());
+		}
+	}
+
+private:
+	const char* mName;
+	int64_t mStart;
+};
+
+}
+
+#endif
@@ -79,6 +79,27 @@ bool testRayVsQuad(
 	return false;
 }
 
+// Rotation matrices here follow bx's row vector convention
+void axisAngleToMtx3(const float* axis, float angle, float* result)
+{
+	float c = bx::fcos(angle);
+	float s = bx::fsin(angle);
+	float t = 1.f - c;
+	float x = axis[0];
+	float y = axis[1];
+	float z = axis[2];
+
+	result[0] = t * x * x + c;
+	result[1] = t * x * y + s * z;
+	result[2] = t * x * z - s * y;
+	result[3] = t * x * y - s * z;
+	result[4] = t * y * y + c;
+	result[5] = t * y * z + s * x;
+	result[6] = t * x * z + s * y;
+	result[7] = t * y * z - s * x;
+	result[8] = t * z * z + c;
+}
+
 }
 
 //https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
@@ -141,5 +162,137 @@ WindowId pickWindow(
 	return window;
 }
 
+void computeVelocity(
+	const float* from, const float* to, float dt,
+	float* angularVelocity, float* linearVelocity
+)
+{
+	float invDt = 1.f / dt;
+	linearVelocity[0] = (to[12] - from[12]) * invDt;
+	linearVelocity[1] = (to[13] - from[13]) * invDt;
+	linearVelocity[2] = (to[14] - from[14]) * invDt;
+
+	// delta = transpose(from) * to, so that to = from * delta
+	float delta[9];
+	for(int row = 0; row < 3; ++row)
+	{
+		for(int col = 0; col < 3; ++col)
+		{
+			delta[row * 3 + col] =
+				from[0 * 4 + row] * to[0 * 4 + col]
+				+ from[1 * 4 + row] * to[1 * 4 + col]
+				+ from[2 * 4 + row] * to[2 * 4 + col];
+		}
+	}
+
+	float cosAngle = bx::fclamp(
+		(delta[0] + delta[4] + delta[8] - 1.f) * 0.5f, -1.f, 1.f
+	);
+	float angle = bx::facos(cosAngle);
+	float sinAngle = bx::fsin(angle);
+	if(sinAngle < gEpsilon)
+	{
+		angularVelocity[0] = 0.f;
+		angularVelocity[1] = 0.f;
+		angularVelocity[2] = 0.f;
+		return;
+	}
+
+	float scale = angle * invDt / (2.f * sinAngle);
+	angularVelocity[0] = (delta[5] - delta[7]) * scale;
+	angularVelocity[1] = (delta[6] - delta[2]) * scale;
+	angularVelocity[2] = (delta[1] - delta[3]) * scale;
+}
+
+void extrapolateTransform(
+	const float* transform,
+	const float* angularVelocity, const float* linearVelocity,
+	float dt,
+	float* result
+)
+{
+	float speed = bx::vec3Length(angularVelocity);
+	float rotation[9] = {
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		0.f, 0.f, 1.f
+	};
+	if(speed > gEpsilon)
+	{
+		float axis[3];
+		bx::vec3Mul(axis, angularVelocity, 1.f / speed);
+		axisAngleToMtx3(axis, speed * dt, rotation);
+	}
+
+	for(int row = 0; row < 3; ++row)
+	{
+		for(int col = 0; col < 3; ++col)
+		{
+			result[row * 4 + col] =
+				transform[row * 4 + 0] * rotation[0 * 3 + col]
+				+ transform[row * 4 + 1] * rotation[1 * 3 + col]
+				+ transform[row * 4 + 2] * rotation[2 * 3 + col];
+		}
+		result[row * 4 + 3] = 0.f;
+	}
+
+	result[12] = transform[12] + linearVelocity[0] * dt;
+	result[13] = transform[13] + linearVelocity[1] * dt;
+	result[14] = transform[14] + linearVelocity[2] * dt;
+	result[15] = 1.f;
+}
+
+void mtxToQuat(const float* transform, float* quat)
+{
+	const float* m = transform;
+	float trace = m[0] + m[5] + m[10];
+	if(trace > 0.f)
+	{
+		float s = bx::fsqrt(1.f + trace) * 2.f;
+		quat[0] = (m[9] - m[6]) / s;
+		quat[1] = (m[2] - m[8]) / s;
+		quat[2] = (m[4] - m[1]) / s;
+		quat[3] = 0.25f * s;
+	}
+	else if(m[0] > m[5] && m[0] > m[10])
+	{
+		float s = bx::fsqrt(1.f + m[0] - m[5] - m[10]) * 2.f;
+		quat[0] = 0.25f * s;
+		quat[1] = (m[1] + m[4]) / s;
+		quat[2] = (m[2] + m[8]) / s;
+		quat[3] = (m[9] - m[6]) / s;
+	}
+	else if(m[5] > m[10])
+	{
+		float s = bx::fsqrt(1.f + m[5] - m[0] - m[10]) * 2.f;
+		quat[0] = (m[1] + m[4]) / s;
+		quat[1] = 0.25f * s;
+		quat[2] = (m[6] + m[9]) / s;
+		quat[3] = (m[2] - m[8]) / s;
+	}
+	else
+	{
+		float s = bx::fsqrt(1.f + m[10] - m[0] - m[5]) * 2.f;
+		quat[0] = (m[2] + m[8]) / s;
+		quat[1] = (m[6] + m[9]) / s;
+		quat[2] = 0.25f * s;
+		quat[3] = (m[4] - m[1]) / s;
+	}
+}
+
+void convertCursorImage(
+	const uint32_t* argbPixels, uint32_t numPixels, uint8_t* rgbaPixels
+)
+{
+	for(uint32_t i = 0; i < numPixels; ++i)
+	{
+		uint32_t pixel = argbPixels[i];
+		rgbaPixels[i * 4 + 0] = (uint8_t)((pixel >> 16) & 0xff);
+		rgbaPixels[i * 4 + 1] = (uint8_t)((pixel >>  8) & 0xff);
+		rgbaPixels[i * 4 + 2] = (uint8_t)((pixel >>  0) & 0xff);
+		rgbaPixels[i * 4 + 3] = (uint8_t)((pixel >> 24) & 0xff);
+	}
+}
+
 }
 }
@@ -1,6 +1,7 @@
 #ifndef XVEEARR_UTILS_HPP
 #define XVEEARR_UTILS_HPP
 
+#include <cstdint>
 #include "IWindowManager.hpp"
 
 namespace xveearr
@@ -14,6 +15,31 @@ WindowId pickWindow(
 	float* rayDirection
 );
 
+// Velocities which take transform from to transform to in dt seconds.
+// angularVelocity is an axis scaled by radians per second, both are in
+// world space.
+void computeVelocity(
+	const float* from, const float* to, float dt,
+	float* angularVelocity, float* linearVelocity
+);
+
+// Move transform along the given velocities for dt seconds
+void extrapolateTransform(
+	const float* transform,
+	const float* angularVelocity, const float* linearVelocity,
+	float dt,
+	float* result
+);
+
+// Rotation part of transform as a quaternion (x, y, z, w), the inverse of
+// bx::mtxQuat
+void mtxToQuat(const float* transform, float* quat);
+
+// X cursor images are 32-bit ARGB words, bgfx textures take RGBA8 bytes
+void convertCursorImage(
+	const uint32_t* argbPixels, uint32_t numPixels, uint8_t* rgbaPixels
+);
+
 }
 }
 
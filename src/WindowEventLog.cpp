@@ -0,0 +1,123 @@
+#include "WindowEventLog.hpp"
+#include <cstring>
+#include <bx/timer.h>
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const char gMagic[8] = { 'X', 'V', 'R', 'E', 'V', 'T', 'S', '2' };
+
+}
+
+WindowEventWriter::WindowEventWriter()
+	:mFile(NULL)
+	,mLastTime(0)
+{}
+
+bool WindowEventWriter::open(
+	const char* path, const DisplayMetrics& displayMetrics
+)
+{
+	mFile = fopen(path, "wb");
+	XVR_ENSURE(mFile != NULL, "Could not open ", path, " for writing");
+	if(fwrite(gMagic, sizeof(gMagic), 1, mFile) != 1
+		|| fwrite(&displayMetrics, sizeof(displayMetrics), 1, mFile) != 1)
+	{
+		close();
+		XVR_LOG(Error, "Could not write to ", path);
+		return false;
+	}
+
+	mLastTime = 0;
+	return true;
+}
+
+void WindowEventWriter::close()
+{
+	if(mFile == NULL) { return; }
+
+	fclose(mFile);
+	mFile = NULL;
+}
+
+bool WindowEventWriter::isOpen() const
+{
+	return mFile != NULL;
+}
+
+void WindowEventWriter::write(
+	int64_t time, const WindowEvent* events, unsigned int numEvents
+)
+{
+	if(mFile == NULL || numEvents == 0) { return; }
+
+	// Whole seconds first so long gaps do not overflow
+	int64_t frequency = bx::getHPFrequency();
+	int64_t elapsed = mLastTime == 0 ? 0 : time - mLastTime;
+	int64_t deltaTime = elapsed / frequency * 1000000
+		+ elapsed % frequency * 1000000 / frequency;
+	mLastTime = time;
+
+	for(unsigned int i = 0; i < numEvents; ++i)
+	{
+		const WindowEvent& event = events[i];
+
+		WindowEventRecord record;
+		memset(&record, 0, sizeof(record));
+		record.mDeltaTime = i == 0 ? (uint64_t)deltaTime : 0;
+		record.mWindow = (uint32_t)event.mWindow;
+		record.mPID = (uint32_t)event.mPID;
+		record.mX = (int16_t)event.mX;
+		record.mY = (int16_t)event.mY;
+		record.mWidth = (uint16_t)event.mWidth;
+		record.mHeight = (uint16_t)event.mHeight;
+		record.mType = (uint8_t)event.mType;
+		record.mChangedFields = (uint8_t)event.mChangedFields;
+		record.mFlags = i == 0 ? WindowEventRecord::BatchStart : 0;
+		if(event.mInvertedY) { record.mFlags |= WindowEventRecord::InvertedY; }
+
+		if(fwrite(&record, sizeof(record), 1, mFile) != 1)
+		{
+			XVR_LOG(Error, "Could not write window events, recording stopped");
+			close();
+			return;
+		}
+	}
+}
+
+bool loadWindowEvents(
+	const char* path,
+	DisplayMetrics& displayMetrics,
+	std::vector<WindowEventRecord>& records
+)
+{
+	FILE* file = fopen(path, "rb");
+	XVR_ENSURE(file != NULL, "Could not open ", path);
+
+	char magic[sizeof(gMagic)];
+	bool valid = fread(magic, sizeof(magic), 1, file) == 1
+		&& memcmp(magic, gMagic, sizeof(gMagic)) == 0
+		&& fread(&displayMetrics, sizeof(displayMetrics), 1, file) == 1;
+	if(!valid)
+	{
+		fclose(file);
+		XVR_LOG(Error, path, " is not a window event recording");
+		return false;
+	}
+
+	records.clear();
+	WindowEventRecord record;
+	while(fread(&record, sizeof(record), 1, file) == 1)
+	{
+		records.push_back(record);
+	}
+	fclose(file);
+
+	return true;
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef XVEEARR_WINDOW_EVENT_LOG_HPP
+#define XVEEARR_WINDOW_EVENT_LOG_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "IWindowSystem.hpp"
+
+namespace xveearr
+{
+
+// Window event files start with an 8 byte magic and the display metrics,
+// followed by one record per event in the byte order of the recording
+// machine
+struct WindowEventRecord
+{
+	enum Flag
+	{
+		// First event returned by a pollEvents call
+		BatchStart = 1 << 0,
+		InvertedY = 1 << 1
+	};
+
+	// Microseconds since the previous record, kiosks can sit idle for
+	// longer than 32 bits hold
+	uint64_t mDeltaTime;
+	uint32_t mWindow;
+	uint32_t mPID;
+	// Geometry right after the event, zero for removed windows
+	int16_t mX;
+	int16_t mY;
+	uint16_t mWidth;
+	uint16_t mHeight;
+	uint8_t mType;
+	uint8_t mChangedFields;
+	uint8_t mFlags;
+	uint8_t mReserved;
+	uint32_t mPadding;
+};
+
+class WindowEventWriter
+{
+public:
+	WindowEventWriter();
+
+	bool open(const char* path, const DisplayMetrics& displayMetrics);
+	void close();
+	bool isOpen() const;
+	// Events returned by one pollEvents call
+	void write(int64_t time, const WindowEvent* events, unsigned int numEvents);
+
+private:
+	FILE* mFile;
+	int64_t mLastTime;
+};
+
+bool loadWindowEvents(
+	const char* path,
+	DisplayMetrics& displayMetrics,
+	std::vector<WindowEventRecord>& records
+);
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "WindowGroups.hpp"
+#include <algorithm>
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const float gZOrderStep = 0.0001f;
+
+}
+
+WindowGroup& WindowGroups::addWindow(PID pid, WindowId window, bool& created)
+{
+	auto result = mGroups.insert(std::make_pair(pid, WindowGroup()));
+	created = result.second;
+	if(created) { mPIDs.push_back(pid); }
+
+	WindowGroup& group = result.first->second;
+	group.mMembers.push_back(window);
+	return group;
+}
+
+void WindowGroups::removeWindow(PID pid, WindowId window)
+{
+	auto itr = mGroups.find(pid);
+	if(itr == mGroups.end()) { return; }
+
+	WindowGroup& group = itr->second;
+	group.mMembers.remove(window);
+	if(!group.mMembers.empty()) { return; }
+
+	mGroups.erase(itr);
+	auto pidItr = std::find(mPIDs.begin(), mPIDs.end(), pid);
+	if(pidItr != mPIDs.end()) { mPIDs.erase(pidItr); }
+}
+
+WindowGroup* WindowGroups::find(PID pid)
+{
+	auto itr = mGroups.find(pid);
+	return itr != mGroups.end() ? &itr->second : NULL;
+}
+
+const std::vector<PID>& WindowGroups::getPIDs() const
+{
+	return mPIDs;
+}
+
+void WindowGroups::getDrawItems(
+	WindowTable& windows, std::vector<DrawItem>& items
+) const
+{
+	items.clear();
+	for(auto&& pair: mGroups)
+	{
+		float zOrder = 0.f;
+		for(WindowId window: pair.second.mMembers)
+		{
+			DrawItem drawItem;
+			drawItem.mGroup = &pair.second;
+			drawItem.mInfo = &windows[window];
+			drawItem.mZOrder = zOrder;
+			items.push_back(drawItem);
+
+			zOrder += gZOrderStep;
+		}
+	}
+}
+
+WindowGroups::const_iterator WindowGroups::begin() const
+{
+	return mGroups.begin();
+}
+
+WindowGroups::const_iterator WindowGroups::end() const
+{
+	return mGroups.end();
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef XVEEARR_WINDOW_GROUPS_HPP
+#define XVEEARR_WINDOW_GROUPS_HPP
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include "IWindowSystem.hpp"
+
+namespace xveearr
+{
+
+struct WindowGroup
+{
+	std::list<WindowId> mMembers;
+	float mTransform[16];
+};
+
+struct DrawItem
+{
+	const WindowGroup* mGroup;
+	const WindowInfo* mInfo;
+	float mZOrder;
+	float mTransform[16];
+};
+
+// Windows of the same process are placed together. Groups are created with
+// their first window and go away with their last one.
+class WindowGroups
+{
+public:
+	typedef std::unordered_map<PID, WindowGroup>::const_iterator const_iterator;
+
+	// created is set when the group is new and its transform still has to be
+	// filled in
+	WindowGroup& addWindow(PID pid, WindowId window, bool& created);
+	void removeWindow(PID pid, WindowId window);
+	WindowGroup* find(PID pid);
+	const std::vector<PID>& getPIDs() const;
+
+	// One item per window in group order, windows later in a group are
+	// stacked in front
+	void getDrawItems(WindowTable& windows, std::vector<DrawItem>& items) const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+private:
+	std::unordered_map<PID, WindowGroup> mGroups;
+	std::vector<PID> mPIDs;
+};
+
+}
+
+#endif
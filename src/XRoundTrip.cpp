@@ -0,0 +1,100 @@
+#include "XRoundTrip.hpp"
+#include <iomanip>
+#include <bx/bx.h>
+#include "Profiler.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "Log.hpp"
+
+namespace xveearr
+{
+
+namespace
+{
+
+static const double gDefaultSlowThreshold = 5.0;
+// Slow round trips tend to come in bursts
+static const unsigned int gSlowLogBurst = 5;
+static const unsigned int gSlowLogIntervalMs = 1000;
+
+static Counter gXRoundTripsMetric(
+	"xveearr_x_round_trips_total", "Requests which waited for the X server"
+);
+static std::atomic<XRoundTripSite*> gFirstSite(NULL);
+static std::atomic<double> gSlowThreshold(gDefaultSlowThreshold);
+
+}
+
+XRoundTripSite::XRoundTripSite(
+	const char* name, const char* file, unsigned int line
+)
+	:mName(name)
+	,mFile(file)
+	,mLine(line)
+	,mMarker(Profiler::registerMarker(name))
+	,mCount(0)
+	,mTotalTime(0)
+	,mMaxTime(0)
+{
+	mNext = gFirstSite.load(std::memory_order_relaxed);
+	while(!gFirstSite.compare_exchange_weak(
+		mNext, this, std::memory_order_release, std::memory_order_relaxed
+	))
+	{}
+}
+
+void XRoundTripSite::record(int64_t start, int64_t end)
+{
+	int64_t duration = end - start;
+	mCount.fetch_add(1, std::memory_order_relaxed);
+	mTotalTime.fetch_add(duration, std::memory_order_relaxed);
+	int64_t maxTime = mMaxTime.load(std::memory_order_relaxed);
+	while(duration > maxTime && !mMaxTime.compare_exchange_weak(
+		maxTime, duration, std::memory_order_relaxed
+	))
+	{}
+
+	Profiler::addTime(mMarker, duration);
+	gXRoundTripsMetric.add();
+	if(Trace::isEnabled()) { Trace::addEvent(mName, start, end); }
+
+	double milliseconds = (double)duration * 1000.0 / (double)bx::getHPFrequency();
+	if(milliseconds > gSlowThreshold.load(std::memory_order_relaxed))
+	{
+		XVR_LOG_RATE_LIMITED(Warn, gSlowLogBurst, gSlowLogIntervalMs,
+			"Slow X round trip ", mName, " at ", mFile, ":", mLine, " took ",
+			std::fixed, std::setprecision(2), milliseconds, " ms"
+		);
+	}
+}
+
+void XRoundTripSite::setSlowThreshold(double milliseconds)
+{
+	gSlowThreshold.store(milliseconds, std::memory_order_relaxed);
+}
+
+void XRoundTripSite::logSummary()
+{
+	double toMs = 1000.0 / (double)bx::getHPFrequency();
+	for(
+		XRoundTripSite* site = gFirstSite.load(std::memory_order_acquire);
+		site != NULL;
+		site = site->mNext
+	)
+	{
+		uint64_t count = site->mCount.load(std::memory_order_relaxed);
+		if(count == 0) { continue; }
+
+		int64_t total = site->mTotalTime.load(std::memory_order_relaxed);
+		XVR_LOG(Info,
+			"X round trip ", std::left, std::setw(20), site->mName,
+			std::right, std::setw(8), count, " call(s), ",
+			std::fixed, std::setprecision(3),
+			"avg ", (double)total * toMs / (double)count, " ms, max ",
+			(double)site->mMaxTime.load(std::memory_order_relaxed) * toMs,
+			" ms"
+		);
+	}
+}
+
+}
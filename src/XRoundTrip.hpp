@@ -0,0 +1,69 @@
+#ifndef XVEEARR_X_ROUND_TRIP_HPP
+#define XVEEARR_X_ROUND_TRIP_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <bx/timer.h>
+
+// Evaluates a call which blocks until the X server replies, usually an
+// xcb_*_reply or xcb_request_check, and accounts it to the call site. NAME
+// must be a string literal.
+#define XVR_X_ROUND_TRIP(NAME, ...) \
+	([&]() { \
+		static ::xveearr::XRoundTripSite xvrRoundTripSite( \
+			NAME, __FILE__, __LINE__ \
+		); \
+		::xveearr::XRoundTripScope xvrRoundTripScope(xvrRoundTripSite); \
+		return __VA_ARGS__; \
+	}())
+
+namespace xveearr
+{
+
+// Counts and latency of the round trips made from one place. Each site is
+// also a profiler marker, which gives the per-frame counts.
+class XRoundTripSite
+{
+public:
+	XRoundTripSite(const char* name, const char* file, unsigned int line);
+
+	// Any thread
+	void record(int64_t start, int64_t end);
+
+	// Round trips slower than this are logged, in milliseconds
+	static void setSlowThreshold(double milliseconds);
+	// Totals of every site which was used, to the log
+	static void logSummary();
+
+private:
+	const char* mName;
+	const char* mFile;
+	unsigned int mLine;
+	unsigned int mMarker;
+	std::atomic<uint64_t> mCount;
+	std::atomic<int64_t> mTotalTime;
+	std::atomic<int64_t> mMaxTime;
+	XRoundTripSite* mNext;
+};
+
+class XRoundTripScope
+{
+public:
+	explicit XRoundTripScope(XRoundTripSite& site)
+		:mSite(site)
+		,mStart(bx::getHPCounter())
+	{}
+
+	~XRoundTripScope()
+	{
+		mSite.record(mStart, bx::getHPCounter());
+	}
+
+private:
+	XRoundTripSite& mSite;
+	int64_t mStart;
+};
+
+}
+
+#endif
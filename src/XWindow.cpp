@@ -3,12 +3,17 @@
 #if BX_PLATFORM_LINUX == 1
 
 #include "IWindowSystem.hpp"
+#include <cstring>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
+#include <poll.h>
 #include <SDL_syswm.h>
 #include <SDL.h>
 #include <bx/spscqueue.h>
+#include <bx/thread.h>
 #include <bx/macros.h>
+#include <bx/commandline.h>
 #include <bgfx/bgfxplatform.h>
 #include <bgfx/bgfx.h>
 #include <X11/Xlib-xcb.h>
@@ -18,11 +23,17 @@
 #include <xcb/res.h>
 #include <xcb/xcb_ewmh.h>
 #include <xcb/xfixes.h>
+#include <xcb/damage.h>
 #include <GL/gl.h>
 #include <GL/glx.h>
 #include <GL/glext.h>
+#include "EventBuffer.hpp"
 #include "Registry.hpp"
 #include "Log.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "XRoundTrip.hpp"
+#include "Utils.hpp"
 
 namespace xveearr
 {
@@ -30,6 +41,29 @@ namespace xveearr
 namespace
 {
 
+// Batch sizes the event and request buffers start with
+static const unsigned int gReservedEvents = 256;
+static const unsigned int gReservedTextureReqs = 64;
+// Per event debug lines, per call site
+static const unsigned int gLogBurst = 10;
+static const unsigned int gLogIntervalMs = 1000;
+
+static Gauge gTextureReqsMetric(
+	"xveearr_texture_requests_queued",
+	"Texture requests which were not executed yet"
+);
+static Gauge gCursorCacheMetric(
+	"xveearr_cursor_cache_size", "Cursor images kept as textures"
+);
+
+struct TextureInfo
+{
+	GLuint mGLHandle;
+	xcb_window_t mWindow;
+	xcb_pixmap_t mCompositePixmap;
+	GLXPixmap mGLXPixmap;
+};
+
 struct TextureReq
 {
 	enum Type
@@ -37,6 +71,10 @@ struct TextureReq
 		Bind,
 		Rebind,
 		Unbind,
+		// Free a texture replaced by Rebind, only used by the upload thread
+		Release,
+		// Stop the upload thread
+		Exit,
 
 		Count
 	};
@@ -44,14 +82,23 @@ struct TextureReq
 	Type mType;
 	bgfx::TextureHandle mBgfxHandle;
 	xcb_window_t mWindow;
+	// Number of times mBgfxHandle was unbound when the request was sent to
+	// the upload thread
+	uint32_t mSerial;
+	// Only used by Release
+	TextureInfo mTexture;
 };
 
-struct TextureInfo
+struct UploadResult
 {
+	bgfx::TextureHandle mBgfxHandle;
+	uint32_t mSerial;
 	GLuint mGLHandle;
-	xcb_window_t mWindow;
-	xcb_pixmap_t mCompositePixmap;
-	GLXPixmap mGLXPixmap;
+	GLsync mFence;
+	// A rebind replaces the texture, the old one can only be released once
+	// bgfx stops using it
+	bool mReplaced;
+	TextureInfo mOldTexture;
 };
 
 const int GLX_PIXMAP_ATTRS[] = {
@@ -80,10 +127,16 @@ class XWindow: public IWindowSystem
 public:
 	XWindow()
 		:mXcbConn(NULL)
+		,mWindows(NULL)
+		,mUploadInitialized(false)
+		,mAsyncUpload(false)
+		,mUploadContext(NULL)
+		,mUploadPbuffer(None)
 		,mEventIndex(0)
+		,mPendingEvent(NULL)
 	{}
 
-	bool init(const WindowSystemCfg& cfg)
+	bool probe()
 	{
 		mglXBindTexImageEXT = (PFNGLXBINDTEXIMAGEEXTPROC)glXGetProcAddress(
 			(const GLubyte*)"glXBindTexImageEXT"
@@ -96,8 +149,21 @@ public:
 			"GLX_EXT_texture_from_pixmap is not available"
 		);
 
+		// Optional, textures are bound on the render thread without them
+		mglFenceSync = (PFNGLFENCESYNCPROC)glXGetProcAddress(
+			(const GLubyte*)"glFenceSync"
+		);
+		mglClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)glXGetProcAddress(
+			(const GLubyte*)"glClientWaitSync"
+		);
+		mglDeleteSync = (PFNGLDELETESYNCPROC)glXGetProcAddress(
+			(const GLubyte*)"glDeleteSync"
+		);
+
 		int screenNumber;
-		mXcbConn = xcb_connect(NULL, &screenNumber);
+		mXcbConn = XVR_X_ROUND_TRIP(
+			"x connect", xcb_connect(NULL, &screenNumber)
+		);
 		XVR_ENSURE(mXcbConn, "Could not connect to X server");
 
 		xcb_screen_t* screen = getScreenOfDisplay(mXcbConn, screenNumber);
@@ -110,20 +176,34 @@ public:
 		xcb_prefetch_extension_data(mXcbConn, &xcb_composite_id);
 		xcb_prefetch_extension_data(mXcbConn, &xcb_res_id);
 		xcb_prefetch_extension_data(mXcbConn, &xcb_xfixes_id);
+		xcb_prefetch_extension_data(mXcbConn, &xcb_damage_id);
 
-		const xcb_query_extension_reply_t* xcomposite =
-			xcb_get_extension_data(mXcbConn, &xcb_composite_id);
+		const xcb_query_extension_reply_t* xcomposite = XVR_X_ROUND_TRIP(
+			"x query extension",
+			xcb_get_extension_data(mXcbConn, &xcb_composite_id)
+		);
 		XVR_ENSURE(xcomposite->present, xcb_composite_id.name, " is not available");
 
-		const xcb_query_extension_reply_t* xres =
-			xcb_get_extension_data(mXcbConn, &xcb_res_id);
+		const xcb_query_extension_reply_t* xres = XVR_X_ROUND_TRIP(
+			"x query extension",
+			xcb_get_extension_data(mXcbConn, &xcb_res_id)
+		);
 		XVR_ENSURE(xres->present, xcb_res_id.name, " is not available");
 
-		const xcb_query_extension_reply_t* xfixes =
-			xcb_get_extension_data(mXcbConn, &xcb_xfixes_id);
+		const xcb_query_extension_reply_t* xfixes = XVR_X_ROUND_TRIP(
+			"x query extension",
+			xcb_get_extension_data(mXcbConn, &xcb_xfixes_id)
+		);
 		XVR_ENSURE(xfixes->present, xcb_xfixes_id.name, " is not available");
 		mXFixesFirstEvent = xfixes->first_event;
 
+		const xcb_query_extension_reply_t* damage = XVR_X_ROUND_TRIP(
+			"x query extension",
+			xcb_get_extension_data(mXcbConn, &xcb_damage_id)
+		);
+		XVR_ENSURE(damage->present, xcb_damage_id.name, " is not available");
+		mDamageFirstEvent = damage->first_event;
+
 		xcb_xfixes_query_version_unchecked(
 			mXcbConn,
 			XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION
@@ -132,17 +212,17 @@ public:
 			mXcbConn,
 			XCB_RES_MAJOR_VERSION, XCB_RES_MINOR_VERSION
 		);
-
-		SDL_SysWMinfo wmi;
-		SDL_GetVersion(&wmi.version);
-		SDL_GetWindowWMInfo(cfg.mWindow, &wmi);
-		mRendererDisplay = wmi.info.x11.display;
-		mRendererXcbConn = XGetXCBConnection(mRendererDisplay);
-		mPID = getClientPidFromWindow(wmi.info.x11.window);
+		xcb_damage_query_version_unchecked(
+			mXcbConn,
+			XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION
+		);
 
 		xcb_generic_error_t *error;
 		xcb_void_cookie_t voidCookie = xcb_grab_server_checked(mXcbConn);
-		if((error = xcb_request_check(mXcbConn, voidCookie)))
+		error = XVR_X_ROUND_TRIP(
+			"x grab server", xcb_request_check(mXcbConn, voidCookie)
+		);
+		if(error)
 		{
 			free(error);
 			XVR_LOG(Error, "Could not grab server");
@@ -182,7 +262,10 @@ public:
 
 		for(xcb_void_cookie_t cookie: cookies)
 		{
-			if((error = xcb_request_check(mXcbConn, cookie)))
+			error = XVR_X_ROUND_TRIP(
+				"x select root input", xcb_request_check(mXcbConn, cookie)
+			);
+			if(error)
 			{
 				free(error);
 				XVR_LOG(Error, "Some request failed");
@@ -191,8 +274,11 @@ public:
 		}
 
 		xcb_ewmh_connection_t ewmh;
-		uint8_t initStatus = xcb_ewmh_init_atoms_replies(
-			&ewmh, xcb_ewmh_init_atoms(mXcbConn, &ewmh), NULL
+		uint8_t initStatus = XVR_X_ROUND_TRIP(
+			"x ewmh atoms",
+			xcb_ewmh_init_atoms_replies(
+				&ewmh, xcb_ewmh_init_atoms(mXcbConn, &ewmh), NULL
+			)
 		);
 		if(!initStatus)
 		{
@@ -202,14 +288,17 @@ public:
 		}
 
 		xcb_window_t supportWindow;
-		uint8_t supportCheckStatus = xcb_ewmh_get_supporting_wm_check_reply(
-			&ewmh,
-			xcb_ewmh_get_supporting_wm_check(
+		uint8_t supportCheckStatus = XVR_X_ROUND_TRIP(
+			"x ewmh wm check",
+			xcb_ewmh_get_supporting_wm_check_reply(
 				&ewmh,
-				xcb_setup_roots_iterator(xcb_get_setup(mXcbConn)).data->root
-			),
-			&supportWindow,
-			NULL
+				xcb_ewmh_get_supporting_wm_check(
+					&ewmh,
+					xcb_setup_roots_iterator(xcb_get_setup(mXcbConn)).data->root
+				),
+				&supportWindow,
+				NULL
+			)
 		);
 		if(!supportCheckStatus)
 		{
@@ -223,7 +312,10 @@ public:
 		XVR_ENSURE(mWindowMgrPid, "Could not retrieve PID of window manager");
 
 		voidCookie = xcb_ungrab_server_checked(mXcbConn);
-		if((error = xcb_request_check(mXcbConn, voidCookie)))
+		error = XVR_X_ROUND_TRIP(
+			"x ungrab server", xcb_request_check(mXcbConn, voidCookie)
+		);
+		if(error)
 		{
 			free(error);
 			XVR_LOG(Error, "Could not ungrab server");
@@ -233,8 +325,36 @@ public:
 		return true;
 	}
 
+	bool init(const WindowSystemCfg& cfg)
+	{
+		mWindows = cfg.mWindowTable;
+		mTmpEventBuff.reserve(gReservedEvents);
+		mEvents.reserve(gReservedEvents);
+		mDeferredTextureReqs.reserve(gReservedTextureReqs);
+
+		const char* slowThresholdStr = cfg.mCmdLine->findOption("x-slow-ms");
+		if(slowThresholdStr)
+		{
+			XRoundTripSite::setSlowThreshold(atof(slowThresholdStr));
+		}
+
+		SDL_SysWMinfo wmi;
+		SDL_GetVersion(&wmi.version);
+		SDL_GetWindowWMInfo(cfg.mWindow, &wmi);
+		XVR_ENSURE(wmi.subsystem == SDL_SYSWM_X11, "Unsupported subsystem");
+
+		mRendererDisplay = wmi.info.x11.display;
+		mRendererXcbConn = XGetXCBConnection(mRendererDisplay);
+		mPID = getClientPidFromWindow(wmi.info.x11.window);
+
+		return true;
+	}
+
 	void shutdown()
 	{
+		XRoundTripSite::logSummary();
+		free(mPendingEvent);
+		mPendingEvent = NULL;
 		if(mXcbConn != NULL) { xcb_disconnect(mXcbConn); }
 	}
 
@@ -243,91 +363,51 @@ public:
 		return "xwindow";
 	}
 
+	bool isSynthetic() const
+	{
+		return false;
+	}
+
 	DisplayMetrics getDisplayMetrics() { return mDisplayMetrics; }
 
-	bool pollEvent(WindowEvent& xvrEvent)
+	unsigned int pollEvents(WindowEvent* events, unsigned int maxEvents)
 	{
-		if(tryDrainEvent(xvrEvent)) { return true; }
+		if(mEventIndex >= mEvents.size()) { fetchEvents(); }
 
-		// Quickly drain all pending events into a temp buff
-		mTmpEventBuff.clear();
-		xcb_generic_event_t* xcbEvent;
-		while((xcbEvent = xcb_poll_for_event(mXcbConn)))
-		{
-			WindowEvent tmpEvent;
-			uint8_t respType = XCB_EVENT_RESPONSE_TYPE(xcbEvent);
-			if(respType == mXFixesFirstEvent + XCB_XFIXES_CURSOR_NOTIFY)
-			{
-				updateCursorInfo(
-					(xcb_xfixes_cursor_notify_event_t*)xcbEvent
-				);
-			}
-			else
-			{
-				switch(respType)
-				{
-					case XCB_MAP_NOTIFY:
-						tmpEvent.mWindow =
-							((xcb_map_notify_event_t*)xcbEvent)->window;
-						tmpEvent.mType = WindowEvent::WindowAdded;
-						bufferEvent(tmpEvent);
-						break;
-					case XCB_UNMAP_NOTIFY:
-						tmpEvent.mWindow =
-							((xcb_unmap_notify_event_t*)xcbEvent)->window;
-						tmpEvent.mType = WindowEvent::WindowRemoved;
-						bufferEvent(tmpEvent);
-						break;
-					case XCB_REPARENT_NOTIFY:
-						// TODO: handle reparent to root
-						tmpEvent.mWindow =
-							((xcb_reparent_notify_event_t*)xcbEvent)->window;
-						tmpEvent.mType = WindowEvent::WindowRemoved;
-						bufferEvent(tmpEvent);
-						break;
-					case XCB_CONFIGURE_NOTIFY:
-						{
-							xcb_configure_notify_event_t* cfgNotifyEvent =
-								(xcb_configure_notify_event_t*)xcbEvent;
-							tmpEvent.mWindow = cfgNotifyEvent->window;
-							tmpEvent.mType = WindowEvent::WindowUpdated;
-							tmpEvent.mInfo.mX = cfgNotifyEvent->x;
-							tmpEvent.mInfo.mY = cfgNotifyEvent->y;
-							tmpEvent.mInfo.mWidth = cfgNotifyEvent->width;
-							tmpEvent.mInfo.mHeight = cfgNotifyEvent->height;
-							bufferEvent(tmpEvent);
-						}
-						break;
-				}
-			}
+		unsigned int numEvents = std::min(
+			maxEvents, (unsigned int)mEvents.size() - mEventIndex
+		);
+		std::copy(
+			mEvents.begin() + mEventIndex,
+			mEvents.begin() + mEventIndex + numEvents,
+			events
+		);
+		mEventIndex += numEvents;
 
-			free(xcbEvent);
-		}
+		return numEvents;
+	}
 
-		// Process buffered events and queue them
-		mEventIndex = 0;
-		mEvents.clear();
-		for(WindowEvent tmpEvent: mTmpEventBuff)
-		{
-			bool accepted = false;
-			switch(tmpEvent.mType)
-			{
-				case WindowEvent::WindowAdded:
-					accepted = translateWindowAdded(tmpEvent);
-					break;
-				case WindowEvent::WindowRemoved:
-					accepted = translateWindowRemoved(tmpEvent);
-					break;
-				case WindowEvent::WindowUpdated:
-					accepted = translateWindowUpdated(tmpEvent);
-					break;
-			}
+	void waitEvent(unsigned int timeoutMs)
+	{
+		xcb_flush(mXcbConn);
 
-			if(accepted) { mEvents.push_back(tmpEvent); }
+		// Replies read by other requests can leave events in xcb's queue
+		// without the socket being readable
+		if(mPendingEvent == NULL)
+		{
+			mPendingEvent = xcb_poll_for_queued_event(mXcbConn);
 		}
-
-		// Try draining again
-		return tryDrainEvent(xvrEvent);
+		if(mPendingEvent != NULL) { return; }
+
+		// SDL receives its events through the renderer's connection. Events
+		// which were already read into Xlib's queue by the render thread
+		// will only be noticed after the timeout.
+		pollfd fds[2];
+		fds[0].fd = xcb_get_file_descriptor(mXcbConn);
+		fds[0].events = POLLIN;
+		fds[1].fd = ConnectionNumber(mRendererDisplay);
+		fds[1].events = POLLIN;
+		poll(fds, BX_COUNTOF(fds), (int)timeoutMs);
 	}
 
 	void initRenderer()
@@ -355,38 +435,82 @@ public:
 
 	void shutdownRenderer()
 	{
+		if(mAsyncUpload)
+		{
+			TextureReq* req = new TextureReq;
+			req->mType = TextureReq::Exit;
+			mUploadReqs.push(req);
+			mUploadThread.shutdown();
+
+			// Fences are destroyed along with the context
+			for(UploadResult* result: mPendingResults) { delete result; }
+			mPendingResults.clear();
+			while(mUploadResults.peek()) { delete mUploadResults.pop(); }
+		}
+
+		if(mUploadContext != NULL)
+		{
+			glXDestroyContext(mRendererDisplay, mUploadContext);
+			mUploadContext = NULL;
+		}
+		if(mUploadPbuffer != None)
+		{
+			glXDestroyPbuffer(mRendererDisplay, mUploadPbuffer);
+			mUploadPbuffer = None;
+		}
+
+		gTextureReqsMetric.add(-(int64_t)mDeferredTextureReqs.size());
+		for(TextureReq* req: mDeferredTextureReqs) { delete req; }
+		mDeferredTextureReqs.clear();
+		mAsyncUpload = false;
 	}
 
 	void beginRender()
 	{
+		// Requests popped here were issued before the frame which is about
+		// to be rendered so their bgfx textures exist by endRender
 		while(mTextureReqs.peek())
 		{
-			TextureReq* req = mTextureReqs.pop();
-			if(req->mType == TextureReq::Bind)
-			{
-				mDeferredTextureReqs.push_back(*req);
-			}
-			else
-			{
-				executeTextureReq(*req);
-			}
-			delete req;
+			mDeferredTextureReqs.push_back(mTextureReqs.pop());
 		}
 	}
 
 	void endRender()
 	{
-		for(const TextureReq& req: mDeferredTextureReqs)
+		// bgfx creates its context during the first frames
+		if(glXGetCurrentContext() == NULL) { return; }
+
+		if(!mUploadInitialized)
+		{
+			mUploadInitialized = true;
+			mAsyncUpload = initUploadThread();
+		}
+
+		if(mAsyncUpload) { applyUploadResults(); }
+
+		for(TextureReq* req: mDeferredTextureReqs)
 		{
-			executeTextureReq(req);
+			if(mAsyncUpload)
+			{
+				uint32_t& serial = mUnbindSerials[req->mBgfxHandle.idx];
+				if(req->mType == TextureReq::Unbind) { ++serial; }
+				req->mSerial = serial;
+				mUploadReqs.push(req);
+			}
+			else
+			{
+				executeTextureReq(*req);
+				gTextureReqsMetric.add(-1);
+				delete req;
+			}
 		}
 		mDeferredTextureReqs.clear();
 	}
 
 	const WindowInfo* getWindowInfo(WindowId id)
 	{
-		auto itr = mWindows.find(id);
-		return itr != mWindows.end() ? &itr->second : NULL;
+		auto itr = mWindows->find(id);
+		return itr != mWindows->end() ? &itr->second : NULL;
 	}
 
 	CursorInfo getCursorInfo()
@@ -415,10 +539,12 @@ private:
 		xcb_res_client_id_spec_t idSpecs;
 		idSpecs.client = window;
 		idSpecs.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
-		xcb_res_query_client_ids_reply_t* idReply =
+		xcb_res_query_client_ids_reply_t* idReply = XVR_X_ROUND_TRIP(
+			"x client ids",
 			xcb_res_query_client_ids_reply(
 				mXcbConn, xcb_res_query_client_ids(mXcbConn, 1, &idSpecs), NULL
-			);
+			)
+		);
 
 		if(!idReply) { return 0; }
 
@@ -437,8 +563,9 @@ private:
 
 		if(pid == 0 || pid != mWindowMgrPid) { return pid; }
 
-		xcb_query_tree_reply_t* queryTreeReply = xcb_query_tree_reply(
-			mXcbConn, xcb_query_tree(mXcbConn, window), NULL
+		xcb_query_tree_reply_t* queryTreeReply = XVR_X_ROUND_TRIP(
+			"x query tree",
+			xcb_query_tree_reply(mXcbConn, xcb_query_tree(mXcbConn, window), NULL)
 		);
 		if(!queryTreeReply) { return 0; }
 
@@ -458,76 +585,139 @@ private:
 		return 0;
 	}
 
-	bool tryDrainEvent(WindowEvent& xvrEvent)
+	void fetchEvents()
 	{
-		if(mEventIndex < mEvents.size())
+		// Quickly drain all pending events into a temp buff
+		mTmpEventBuff.clear();
+		if(mPendingEvent != NULL)
 		{
-			xvrEvent = mEvents[mEventIndex++];
-			return true;
+			bufferXcbEvent(mPendingEvent);
+			free(mPendingEvent);
+			mPendingEvent = NULL;
 		}
-		else
+
+		xcb_generic_event_t* xcbEvent;
+		while((xcbEvent = xcb_poll_for_event(mXcbConn)))
 		{
-			return false;
+			bufferXcbEvent(xcbEvent);
+			free(xcbEvent);
+		}
+
+		// Process buffered events and queue them
+		mEventIndex = 0;
+		mEvents.clear();
+		for(const BufferedEvent& tmpEvent: mTmpEventBuff)
+		{
+			WindowEvent xvrEvent;
+			memset(&xvrEvent, 0, sizeof(xvrEvent));
+			bool accepted = false;
+			switch(tmpEvent.mType)
+			{
+				case WindowEvent::WindowAdded:
+					accepted = translateWindowAdded(tmpEvent, xvrEvent);
+					break;
+				case WindowEvent::WindowRemoved:
+					accepted = translateWindowRemoved(tmpEvent, xvrEvent);
+					break;
+				case WindowEvent::WindowUpdated:
+					accepted = translateWindowUpdated(tmpEvent, xvrEvent);
+					break;
+			}
+
+			if(!accepted) { continue; }
+
+			xvrEvent.mTime = tmpEvent.mTime;
+			// Later events of the batch may change the entry again
+			auto itr = mWindows->find(xvrEvent.mWindow);
+			if(itr != mWindows->end())
+			{
+				const WindowInfo& info = itr->second;
+				xvrEvent.mX = info.mX;
+				xvrEvent.mY = info.mY;
+				xvrEvent.mWidth = info.mWidth;
+				xvrEvent.mHeight = info.mHeight;
+				xvrEvent.mInvertedY = info.mInvertedY;
+			}
+			mEvents.push_back(xvrEvent);
 		}
 	}
 
-	void bufferEvent(WindowEvent& event)
+	void bufferXcbEvent(xcb_generic_event_t* xcbEvent)
 	{
-		switch(event.mType)
+		BufferedEvent tmpEvent;
+		tmpEvent.mFields = 0;
+		tmpEvent.mTime = bx::getHPCounter();
+		uint8_t respType = XCB_EVENT_RESPONSE_TYPE(xcbEvent);
+		if(respType == mXFixesFirstEvent + XCB_XFIXES_CURSOR_NOTIFY)
 		{
-			case WindowEvent::WindowRemoved:
-				{
-					bool completeCycle = false;
-					for(
-						auto itr = mTmpEventBuff.begin();
-						itr != mTmpEventBuff.end();
-					)
-					{
-						if(itr->mWindow == event.mWindow)
-						{
-							itr = mTmpEventBuff.erase(itr);
-							if(itr->mType == WindowEvent::WindowAdded)
-							{
-								completeCycle = true;
-							}
-						}
-						else
-						{
-							++itr;
-						}
-					}
-
-					if(!completeCycle) { mTmpEventBuff.push_back(event); }
-				}
-				break;
-			case WindowEvent::WindowUpdated:
-				{
-					bool coalesced = false;
-					for(WindowEvent& pastEvent: mTmpEventBuff)
+			updateCursorInfo((xcb_xfixes_cursor_notify_event_t*)xcbEvent);
+		}
+		else if(respType == mDamageFirstEvent + XCB_DAMAGE_NOTIFY)
+		{
+			xcb_damage_notify_event_t* damageEvent =
+				(xcb_damage_notify_event_t*)xcbEvent;
+			// Re-arm the damage object, only the fact that something
+			// changed is needed
+			xcb_damage_subtract(mXcbConn, damageEvent->damage, XCB_NONE, XCB_NONE);
+			tmpEvent.mWindow = damageEvent->drawable;
+			tmpEvent.mType = WindowEvent::WindowUpdated;
+			tmpEvent.mFields = WindowEvent::Content;
+			mTmpEventBuff.push(tmpEvent);
+		}
+		else
+		{
+			switch(respType)
+			{
+				case XCB_MAP_NOTIFY:
+					tmpEvent.mWindow =
+						((xcb_map_notify_event_t*)xcbEvent)->window;
+					tmpEvent.mType = WindowEvent::WindowAdded;
+					mTmpEventBuff.push(tmpEvent);
+					break;
+				case XCB_UNMAP_NOTIFY:
+					tmpEvent.mWindow =
+						((xcb_unmap_notify_event_t*)xcbEvent)->window;
+					tmpEvent.mType = WindowEvent::WindowRemoved;
+					mTmpEventBuff.push(tmpEvent);
+					break;
+				case XCB_REPARENT_NOTIFY:
+					// TODO: handle reparent to root
+					tmpEvent.mWindow =
+						((xcb_reparent_notify_event_t*)xcbEvent)->window;
+					tmpEvent.mType = WindowEvent::WindowRemoved;
+					mTmpEventBuff.push(tmpEvent);
+					break;
+				case XCB_CONFIGURE_NOTIFY:
 					{
-						if(pastEvent.mWindow == event.mWindow)
-						{
-							pastEvent.mInfo = event.mInfo;
-							coalesced = true;
-						}
+						xcb_configure_notify_event_t* cfgNotifyEvent =
+							(xcb_configure_notify_event_t*)xcbEvent;
+						tmpEvent.mWindow = cfgNotifyEvent->window;
+						tmpEvent.mType = WindowEvent::WindowUpdated;
+						tmpEvent.mX = cfgNotifyEvent->x;
+						tmpEvent.mY = cfgNotifyEvent->y;
+						tmpEvent.mWidth = cfgNotifyEvent->width;
+						tmpEvent.mHeight = cfgNotifyEvent->height;
+						tmpEvent.mFields =
+							WindowEvent::Position | WindowEvent::Size;
+						mTmpEventBuff.push(tmpEvent);
 					}
-
-					if(!coalesced) { mTmpEventBuff.push_back(event); }
-				}
-				break;
-			default:
-				mTmpEventBuff.push_back(event);
-				break;
+					break;
+			}
 		}
 	}
 
-	bool translateWindowAdded(WindowEvent& event)
+	bool translateWindowAdded(
+		const BufferedEvent& bufferedEvent, WindowEvent& event
+	)
 	{
-		auto itr = mWindows.find(event.mWindow);
-		if(itr != mWindows.end()) { return false; }
+		auto itr = mWindows->find(bufferedEvent.mWindow);
+		if(itr != mWindows->end()) { return false; }
 
-		xcb_get_geometry_reply_t* geomReply = xcb_get_geometry_reply(
-			mXcbConn, xcb_get_geometry(mXcbConn, event.mWindow), NULL
+		xcb_get_geometry_reply_t* geomReply = XVR_X_ROUND_TRIP(
+			"x window geometry",
+			xcb_get_geometry_reply(
+				mXcbConn, xcb_get_geometry(mXcbConn, bufferedEvent.mWindow), NULL
+			)
 		);
 		XVR_ENSURE(geomReply, "Could not retrieve window's geometry");
 
@@ -535,7 +725,7 @@ private:
 		free(geomReply);
 		XVR_ENSURE(geom.depth != 0, "Window has zero depth");
 
-		uint32_t clientPid = getClientPidFromWindow(event.mWindow);
+		uint32_t clientPid = getClientPidFromWindow(bufferedEvent.mWindow);
 		if(clientPid == 0 || clientPid == mPID) { return false; }
 
 		bgfx::TextureHandle texture =
@@ -549,60 +739,295 @@ private:
 		wndInfo.mTexture = texture;
 		wndInfo.mInvertedY = true;
 		wndInfo.mPID = clientPid;
-		event.mInfo = wndInfo;
-		mWindows.insert(std::make_pair(event.mWindow, wndInfo));
+		mWindows->insert(std::make_pair(bufferedEvent.mWindow, wndInfo));
+
+		xcb_damage_damage_t damage = xcb_generate_id(mXcbConn);
+		xcb_damage_create(
+			mXcbConn, damage, bufferedEvent.mWindow,
+			XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY
+		);
+		mDamages[bufferedEvent.mWindow] = damage;
 
 		TextureReq* req = new TextureReq;
 		req->mType = TextureReq::Bind;
 		req->mBgfxHandle = texture;
-		req->mWindow = event.mWindow;
-		mTextureReqs.push(req);
+		req->mWindow = bufferedEvent.mWindow;
+		pushTextureReq(req);
+
+		event.mType = WindowEvent::WindowAdded;
+		event.mWindow = bufferedEvent.mWindow;
+		event.mPID = clientPid;
+		event.mChangedFields =
+			WindowEvent::Position | WindowEvent::Size | WindowEvent::Texture;
 
 		return true;
 	}
 
-	bool translateWindowRemoved(WindowEvent& event)
+	bool translateWindowRemoved(
+		const BufferedEvent& bufferedEvent, WindowEvent& event
+	)
 	{
-		auto itr = mWindows.find(event.mWindow);
-		if(itr == mWindows.end()) { return false; }
+		auto itr = mWindows->find(bufferedEvent.mWindow);
+		if(itr == mWindows->end()) { return false; }
 
 		TextureReq* req = new TextureReq;
 		req->mType = TextureReq::Unbind;
 		req->mBgfxHandle = itr->second.mTexture;
-		mTextureReqs.push(req);
+		pushTextureReq(req);
+
+		auto damageItr = mDamages.find(bufferedEvent.mWindow);
+		if(damageItr != mDamages.end())
+		{
+			// Fails harmlessly if the window is already destroyed
+			xcb_damage_destroy(mXcbConn, damageItr->second);
+			mDamages.erase(damageItr);
+		}
+
+		event.mType = WindowEvent::WindowRemoved;
+		event.mWindow = bufferedEvent.mWindow;
+		event.mPID = itr->second.mPID;
+		event.mChangedFields = 0;
 
 		bgfx::destroyTexture(itr->second.mTexture);
-		mWindows.erase(itr);
+		mWindows->erase(itr);
 
 		return true;
 	}
 
-	bool translateWindowUpdated(WindowEvent& event)
+	bool translateWindowUpdated(
+		const BufferedEvent& bufferedEvent, WindowEvent& event
+	)
 	{
-		auto itr = mWindows.find(event.mWindow);
-		if(itr == mWindows.end()) { return false; }
+		auto itr = mWindows->find(bufferedEvent.mWindow);
+		if(itr == mWindows->end()) { return false; }
 
 		WindowInfo& wndInfo = itr->second;
 
-		unsigned int oldWidth = wndInfo.mWidth;
-		unsigned int oldHeight = wndInfo.mHeight;
-		wndInfo.mX = event.mInfo.mX;
-		wndInfo.mY = event.mInfo.mY;
-		wndInfo.mWidth = event.mInfo.mWidth;
-		wndInfo.mHeight = event.mInfo.mHeight;
-		event.mInfo = wndInfo;
+		uint32_t changedFields = bufferedEvent.mFields & WindowEvent::Content;
+		if(bufferedEvent.mFields & WindowEvent::Position)
+		{
+			if(wndInfo.mX != bufferedEvent.mX || wndInfo.mY != bufferedEvent.mY)
+			{
+				changedFields |= WindowEvent::Position;
+			}
+			if(
+				wndInfo.mWidth != bufferedEvent.mWidth
+				|| wndInfo.mHeight != bufferedEvent.mHeight
+			)
+			{
+				changedFields |= WindowEvent::Size;
+			}
 
-		if(oldWidth != event.mInfo.mWidth || oldHeight != event.mInfo.mHeight)
+			wndInfo.mX = bufferedEvent.mX;
+			wndInfo.mY = bufferedEvent.mY;
+			wndInfo.mWidth = bufferedEvent.mWidth;
+			wndInfo.mHeight = bufferedEvent.mHeight;
+		}
+
+		// Stacking changes also generate ConfigureNotify
+		if(!changedFields) { return false; }
+
+		if(changedFields & WindowEvent::Size)
 		{
 			TextureReq* req = new TextureReq;
 			req->mType = TextureReq::Rebind;
 			req->mBgfxHandle = wndInfo.mTexture;
-			mTextureReqs.push(req);
+			pushTextureReq(req);
 		}
 
+		event.mType = WindowEvent::WindowUpdated;
+		event.mWindow = bufferedEvent.mWindow;
+		event.mPID = wndInfo.mPID;
+		event.mChangedFields = changedFields;
+
 		return true;
 	}
 
+	bool initUploadThread()
+	{
+		if(!mglFenceSync || !mglClientWaitSync || !mglDeleteSync)
+		{
+			XVR_LOG(Warn, "GL sync objects are not available");
+			return false;
+		}
+
+		const int fbAttrs[] = {
+			GLX_DRAWABLE_TYPE, GLX_PBUFFER_BIT,
+			GLX_RENDER_TYPE, GLX_RGBA_BIT,
+			None
+		};
+		int numConfigs = 0;
+		GLXFBConfig* fbConfigs = glXChooseFBConfig(
+			mRendererDisplay, DefaultScreen(mRendererDisplay),
+			fbAttrs, &numConfigs
+		);
+		if(fbConfigs == NULL || numConfigs == 0)
+		{
+			if(fbConfigs) { XFree(fbConfigs); }
+			XVR_LOG(Warn, "Could not find a FBConfig for texture uploads");
+			return false;
+		}
+
+		const int pbufferAttrs[] = {
+			GLX_PBUFFER_WIDTH, 1,
+			GLX_PBUFFER_HEIGHT, 1,
+			None
+		};
+		mUploadPbuffer = glXCreatePbuffer(
+			mRendererDisplay, fbConfigs[0], pbufferAttrs
+		);
+		mUploadContext = glXCreateNewContext(
+			mRendererDisplay, fbConfigs[0], GLX_RGBA_TYPE,
+			glXGetCurrentContext(), True
+		);
+		XFree(fbConfigs);
+
+		if(mUploadPbuffer == None || mUploadContext == NULL)
+		{
+			XVR_LOG(Warn, "Could not create a shared context for texture uploads");
+			return false;
+		}
+
+		mUploadThread.init(uploadThread, this, 0, "Texture upload thread");
+		XVR_LOG(Info, "Binding textures on the upload thread");
+
+		return true;
+	}
+
+	static int32_t uploadThread(void* userData)
+	{
+		Trace::setThreadName("Texture upload thread");
+		XWindow* self = static_cast<XWindow*>(userData);
+		Display* display = self->mRendererDisplay;
+		glXMakeContextCurrent(
+			display, self->mUploadPbuffer, self->mUploadPbuffer,
+			self->mUploadContext
+		);
+
+		while(true)
+		{
+			TextureReq* req = self->mUploadReqs.pop();
+			if(req == NULL) { continue; }
+
+			bool exit = req->mType == TextureReq::Exit;
+			if(!exit) { self->executeUploadReq(*req); }
+			if(req->mType != TextureReq::Release && !exit)
+			{
+				gTextureReqsMetric.add(-1);
+			}
+			delete req;
+
+			if(exit) { break; }
+		}
+
+		for(auto&& pair: self->mUploadTextures)
+		{
+			self->releaseTexture(pair.second);
+		}
+		self->mUploadTextures.clear();
+		glXMakeContextCurrent(display, None, None, NULL);
+
+		return 0;
+	}
+
+	void executeUploadReq(const TextureReq& req)
+	{
+		XVR_TRACE_SCOPE("upload texture request");
+
+		switch(req.mType)
+		{
+			case TextureReq::Bind:
+			case TextureReq::Rebind:
+				{
+					auto itr = mUploadTextures.find(req.mBgfxHandle.idx);
+					bool replaced = itr != mUploadTextures.end();
+					// Rebinds target an existing texture
+					if(req.mType == TextureReq::Rebind && !replaced) { break; }
+
+					xcb_window_t window =
+						replaced ? itr->second.mWindow : req.mWindow;
+					TextureInfo texInfo;
+					if(!createTexture(window, texInfo)) { break; }
+
+					UploadResult* result = new UploadResult;
+					result->mBgfxHandle = req.mBgfxHandle;
+					result->mSerial = req.mSerial;
+					result->mGLHandle = texInfo.mGLHandle;
+					result->mReplaced = replaced;
+					if(replaced) { result->mOldTexture = itr->second; }
+					result->mFence =
+						mglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+					glFlush();
+					mUploadTextures[req.mBgfxHandle.idx] = texInfo;
+					mUploadResults.push(result);
+				}
+				break;
+			case TextureReq::Unbind:
+				{
+					auto itr = mUploadTextures.find(req.mBgfxHandle.idx);
+					if(itr == mUploadTextures.end()) { break; }
+
+					releaseTexture(itr->second);
+					mUploadTextures.erase(itr);
+				}
+				break;
+			case TextureReq::Release:
+				releaseTexture(req.mTexture);
+				break;
+		}
+	}
+
+	void applyUploadResults()
+	{
+		while(mUploadResults.peek())
+		{
+			mPendingResults.push_back(mUploadResults.pop());
+		}
+
+		// Fences signal in order so the first unsignaled one blocks the rest,
+		// which also keeps successive rebinds of a texture in order
+		unsigned int numApplied = 0;
+		for(UploadResult* result: mPendingResults)
+		{
+			GLenum status = mglClientWaitSync(result->mFence, 0, 0);
+			if(status == GL_TIMEOUT_EXPIRED) { break; }
+
+			mglDeleteSync(result->mFence);
+			// The texture was unbound while this result was in flight
+			bool stale =
+				result->mSerial != mUnbindSerials[result->mBgfxHandle.idx];
+			if(!stale)
+			{
+				bgfx::overrideInternal(result->mBgfxHandle, result->mGLHandle);
+				XVR_LOG_RATE_LIMITED(Debug, gLogBurst, gLogIntervalMs,
+					"Texture ", result->mBgfxHandle.idx, " is ready");
+			}
+
+			if(result->mReplaced)
+			{
+				TextureReq* req = new TextureReq;
+				req->mType = TextureReq::Release;
+				req->mBgfxHandle = result->mBgfxHandle;
+				req->mTexture = result->mOldTexture;
+				mUploadReqs.push(req);
+			}
+
+			delete result;
+			++numApplied;
+		}
+
+		mPendingResults.erase(
+			mPendingResults.begin(), mPendingResults.begin() + numApplied
+		);
+	}
+
+	// Main thread
+	void pushTextureReq(TextureReq* req)
+	{
+		gTextureReqsMetric.add(1);
+		mTextureReqs.push(req);
+	}
+
 	void executeTextureReq(const TextureReq& req)
 	{
 		switch(req.mType)
@@ -621,39 +1046,17 @@ private:
 
 	void bindTexture(const TextureReq& req)
 	{
+		XVR_TRACE_SCOPE("bind texture");
+
 		XVR_LOG(Debug,
 			"Binding window 0x", std::hex, req.mWindow, std::dec,
 			" to texture ", req.mBgfxHandle.idx);
 
-		xcb_pixmap_t compositePixmap;
-		GLXFBConfig fbConfig;
-		if(!getCompositePixmap(req.mWindow, compositePixmap, fbConfig))
-		{
-			return;
-		}
-
-		GLuint glTexture;
-		glGenTextures(1, &glTexture);
-		glBindTexture(GL_TEXTURE_2D, glTexture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		GLXPixmap glxPixmap = glXCreatePixmap(
-			mRendererDisplay, fbConfig, compositePixmap, GLX_PIXMAP_ATTRS
-		);
-		mglXBindTexImageEXT(
-			mRendererDisplay, glxPixmap, GLX_FRONT_LEFT_EXT, NULL
-		);
-
 		TextureInfo texInfo;
-		texInfo.mWindow = req.mWindow;
-		texInfo.mGLHandle = glTexture;
-		texInfo.mCompositePixmap = compositePixmap;
-		texInfo.mGLXPixmap = glxPixmap;
-		mTextures.insert(std::make_pair(req.mBgfxHandle.idx, texInfo));
+		if(!createTexture(req.mWindow, texInfo)) { return; }
 
-		bgfx::overrideInternal(req.mBgfxHandle, glTexture);
+		mTextures.insert(std::make_pair(req.mBgfxHandle.idx, texInfo));
+		bgfx::overrideInternal(req.mBgfxHandle, texInfo.mGLHandle);
 
 		XVR_LOG(Debug,
 			"Window 0x", std::hex, req.mWindow, std::dec,
@@ -662,19 +1065,14 @@ private:
 
 	void unbindTexture(const TextureReq& req)
 	{
+		XVR_TRACE_SCOPE("unbind texture");
+
 		XVR_LOG(Debug, "Unbinding texture ", req.mBgfxHandle.idx);
 
 		auto itr = mTextures.find(req.mBgfxHandle.idx);
 		if(itr == mTextures.end()) { return; }
 
-		TextureInfo& texInfo = itr->second;
-		glBindTexture(GL_TEXTURE_2D, texInfo.mGLHandle);
-		mglXReleaseTexImageEXT(
-			mRendererDisplay, texInfo.mGLXPixmap, GLX_FRONT_LEFT_EXT
-		);
-		glXDestroyPixmap(mRendererDisplay, texInfo.mGLXPixmap);
-		xcb_free_pixmap(mRendererXcbConn, texInfo.mCompositePixmap);
-		glDeleteTextures(1, &texInfo.mGLHandle);
+		releaseTexture(itr->second);
 		mTextures.erase(itr);
 
 		XVR_LOG(Debug, "Texture ", req.mBgfxHandle.idx, " unbound");
@@ -682,27 +1080,42 @@ private:
 
 	void rebindTexture(const TextureReq& req)
 	{
+		XVR_TRACE_SCOPE("rebind texture");
+
 		auto itr = mTextures.find(req.mBgfxHandle.idx);
 		if(itr == mTextures.end()) { return; }
 
-		XVR_LOG(Debug, "Rebinding texture ", req.mBgfxHandle.idx);
+		XVR_LOG_RATE_LIMITED(Debug, gLogBurst, gLogIntervalMs,
+			"Rebinding texture ", req.mBgfxHandle.idx);
 
-		TextureInfo& texInfo = itr->second;
+		TextureInfo texInfo;
+		if(!createTexture(itr->second.mWindow, texInfo)) { return; }
 
+		bgfx::overrideInternal(req.mBgfxHandle, texInfo.mGLHandle);
+		releaseTexture(itr->second);
+		itr->second = texInfo;
+
+		XVR_LOG_RATE_LIMITED(Debug, gLogBurst, gLogIntervalMs,
+			"Texture ", req.mBgfxHandle.idx, " rebound");
+	}
+
+	// Requires a current GL context
+	bool createTexture(xcb_window_t window, TextureInfo& texInfo)
+	{
 		xcb_pixmap_t compositePixmap;
 		GLXFBConfig fbConfig;
-		if(!getCompositePixmap(texInfo.mWindow, compositePixmap, fbConfig))
+		if(!getCompositePixmap(window, compositePixmap, fbConfig))
 		{
-			return;
+			return false;
 		}
 
-		glBindTexture(GL_TEXTURE_2D, texInfo.mGLHandle);
-		mglXReleaseTexImageEXT(
-			mRendererDisplay, texInfo.mGLXPixmap,GLX_FRONT_LEFT_EXT
-		);
-		glXDestroyPixmap(mRendererDisplay, texInfo.mGLXPixmap);
-		xcb_free_pixmap(mRendererXcbConn, texInfo.mCompositePixmap);
-
+		GLuint glTexture;
+		glGenTextures(1, &glTexture);
+		glBindTexture(GL_TEXTURE_2D, glTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		GLXPixmap glxPixmap = glXCreatePixmap(
 			mRendererDisplay, fbConfig, compositePixmap, GLX_PIXMAP_ATTRS
 		);
@@ -710,10 +1123,23 @@ private:
 			mRendererDisplay, glxPixmap, GLX_FRONT_LEFT_EXT, NULL
 		);
 
+		texInfo.mWindow = window;
+		texInfo.mGLHandle = glTexture;
 		texInfo.mCompositePixmap = compositePixmap;
 		texInfo.mGLXPixmap = glxPixmap;
 
-		XVR_LOG(Debug, "Texture ", req.mBgfxHandle.idx, " rebound");
+		return true;
+	}
+
+	void releaseTexture(const TextureInfo& texInfo)
+	{
+		glBindTexture(GL_TEXTURE_2D, texInfo.mGLHandle);
+		mglXReleaseTexImageEXT(
+			mRendererDisplay, texInfo.mGLXPixmap, GLX_FRONT_LEFT_EXT
+		);
+		glXDestroyPixmap(mRendererDisplay, texInfo.mGLXPixmap);
+		xcb_free_pixmap(mRendererXcbConn, texInfo.mCompositePixmap);
+		glDeleteTextures(1, &texInfo.mGLHandle);
 	}
 
 	bool getCompositePixmap(
@@ -725,10 +1151,13 @@ private:
 		// xcb_request_check will hang here for some reason so it cannot be
 		// pipelined with the later get_geometry request
 		xcb_pixmap_t pixmap = xcb_generate_id(mRendererXcbConn);
-		xcb_generic_error_t* namePixmapError = xcb_request_check(
-			mRendererXcbConn,
-			xcb_composite_name_window_pixmap_checked(
-				mRendererXcbConn, window, pixmap
+		xcb_generic_error_t* namePixmapError = XVR_X_ROUND_TRIP(
+			"x name pixmap",
+			xcb_request_check(
+				mRendererXcbConn,
+				xcb_composite_name_window_pixmap_checked(
+					mRendererXcbConn, window, pixmap
+				)
 			)
 		);
 		if(namePixmapError)
@@ -743,10 +1172,13 @@ private:
 		}
 		free(namePixmapError);
 
-		xcb_get_geometry_reply_t* geomReply = xcb_get_geometry_reply(
-			mRendererXcbConn,
-			xcb_get_geometry(mRendererXcbConn, window),
-			NULL
+		xcb_get_geometry_reply_t* geomReply = XVR_X_ROUND_TRIP(
+			"x pixmap geometry",
+			xcb_get_geometry_reply(
+				mRendererXcbConn,
+				xcb_get_geometry(mRendererXcbConn, window),
+				NULL
+			)
 		);
 		if(geomReply == NULL || geomReply->depth == 0)
 		{
@@ -797,26 +1229,31 @@ private:
 
 	void updateCursorInfo(xcb_xfixes_cursor_notify_event_t* ev)
 	{
-		XVR_LOG(Debug, "Cursor serial: 0x", std::hex, ev->cursor_serial, std::dec);
+		XVR_LOG_RATE_LIMITED(Debug, gLogBurst, gLogIntervalMs,
+			"Cursor serial: 0x", std::hex, ev->cursor_serial, std::dec);
 		if(mCursors.find(ev->cursor_serial) == mCursors.end())
 		{
 			retrieveCurrentCursor();
 		}
 		else
 		{
-			XVR_LOG(Debug, "Using cached cursor");
+			XVR_LOG_RATE_LIMITED(Debug, gLogBurst, gLogIntervalMs,
+				"Using cached cursor");
 			mCurrentCursor = ev->cursor_serial;
 		}
 	}
 
 	void retrieveCurrentCursor()
 	{
-		XVR_LOG(Debug, "Retrieving current cursor");
+		XVR_LOG_RATE_LIMITED(Debug, gLogBurst, gLogIntervalMs,
+			"Retrieving current cursor");
 
-		xcb_xfixes_get_cursor_image_reply_t* cursorImage =
+		xcb_xfixes_get_cursor_image_reply_t* cursorImage = XVR_X_ROUND_TRIP(
+			"x cursor image",
 			xcb_xfixes_get_cursor_image_reply(
 				mXcbConn, xcb_xfixes_get_cursor_image(mXcbConn), NULL
-			);
+			)
+		);
 		if(!cursorImage) { return; }
 
 		CursorInfo cursorInfo;
@@ -829,18 +1266,7 @@ private:
 		const uint32_t* imageData =
 			xcb_xfixes_get_cursor_image_cursor_image(cursorImage);
 		const bgfx::Memory* imgBuff = bgfx::alloc(imgSize * sizeof(uint32_t));
-		for(uint32_t i = 0; i < imgSize; ++i)
-		{
-			uint32_t pixel = imageData[i];
-			uint8_t a = (pixel >> 24) & 0xff;
-			uint8_t r = (pixel >> 16) & 0xff;
-			uint8_t g = (pixel >>  8) & 0xff;
-			uint8_t b = (pixel >>  0) & 0xff;
-			imgBuff->data[i * 4 + 0] = r;
-			imgBuff->data[i * 4 + 1] = g;
-			imgBuff->data[i * 4 + 2] = b;
-			imgBuff->data[i * 4 + 3] = a;
-		}
+		utils::convertCursorImage(imageData, imgSize, imgBuff->data);
 		cursorInfo.mTexture = bgfx::createTexture2D(
 			cursorImage->width, cursorImage->height, 0,
 			bgfx::TextureFormat::RGBA8,
@@ -852,6 +1278,7 @@ private:
 		mCursors.insert(
 			std::make_pair(cursorImage->cursor_serial, cursorInfo)
 		);
+		gCursorCacheMetric.set((int64_t)mCursors.size());
 
 		free(cursorImage);
 	}
@@ -862,18 +1289,36 @@ private:
 	PID mPID;
 	uint32_t mWindowMgrPid;
 	DisplayMetrics mDisplayMetrics;
-	std::unordered_map<WindowId, WindowInfo> mWindows;
+	WindowTable* mWindows;
 	bx::SpScUnboundedQueue<TextureReq> mTextureReqs;
-	std::vector<TextureReq> mDeferredTextureReqs;
+	std::vector<TextureReq*> mDeferredTextureReqs;
+	// Only used when textures are bound on the render thread
 	std::unordered_map<uint16_t, TextureInfo> mTextures;
+	bool mUploadInitialized;
+	bool mAsyncUpload;
+	GLXContext mUploadContext;
+	GLXPbuffer mUploadPbuffer;
+	bx::Thread mUploadThread;
+	bx::SpScBlockingUnboundedQueue<TextureReq> mUploadReqs;
+	bx::SpScUnboundedQueue<UploadResult> mUploadResults;
+	// Owned by the upload thread
+	std::unordered_map<uint16_t, TextureInfo> mUploadTextures;
+	std::vector<UploadResult*> mPendingResults;
+	std::unordered_map<uint16_t, uint32_t> mUnbindSerials;
 	unsigned int mEventIndex;
 	std::vector<WindowEvent> mEvents;
-	std::vector<WindowEvent> mTmpEventBuff;
+	EventBuffer mTmpEventBuff;
+	xcb_generic_event_t* mPendingEvent;
+	std::unordered_map<xcb_window_t, xcb_damage_damage_t> mDamages;
 	std::unordered_map<uint32_t, CursorInfo> mCursors;
 	uint32_t mCurrentCursor;
 	uint8_t mXFixesFirstEvent;
+	uint8_t mDamageFirstEvent;
 	PFNGLXBINDTEXIMAGEEXTPROC mglXBindTexImageEXT;
 	PFNGLXRELEASETEXIMAGEEXTPROC mglXReleaseTexImageEXT;
+	PFNGLFENCESYNCPROC mglFenceSync;
+	PFNGLCLIENTWAITSYNCPROC mglClientWaitSync;
+	PFNGLDELETESYNCPROC mglDeleteSync;
 };
 
 XVR_REGISTER(IWindowSystem, XWindow)
@@ -3,6 +3,11 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
 #define SDL_MAIN_HANDLED
 #include <SDL_syswm.h>
 #include <SDL.h>
@@ -13,7 +18,9 @@
 #include <bx/thread.h>
 #include <bx/sem.h>
 #include <bx/fpumath.h>
+#include <bx/timer.h>
 #include <bx/commandline.h>
+#include <bx/string.h>
 #include "config.h"
 #include "shaders/quad.vsh.h"
 #include "shaders/quad.fsh.h"
@@ -22,8 +29,28 @@
 #include "IWindowSystem.hpp"
 #include "IHMD.hpp"
 #include "IController.hpp"
+#include "JobSystem.hpp"
+#include "FrameScheduler.hpp"
+#include "LateLatch.hpp"
+#include "Reprojection.hpp"
+#include "DynamicResolution.hpp"
+#include "PoseRecording.hpp"
+#include "EventRecorder.hpp"
+#include "Benchmark.hpp"
+#include "WindowGroups.hpp"
+#include "DesktopSpace.hpp"
+#include "Profiler.hpp"
+#include "Latency.hpp"
+#include "Allocations.hpp"
+#include "Metrics.hpp"
+#include "MetricsServer.hpp"
+#include "Trace.hpp"
 #include "Log.hpp"
 
+#if BX_PLATFORM_LINUX == 1
+#	include <X11/Xlib.h>
+#endif
+
 XVR_DEFINE_REGISTRY(xveearr::IHMD)
 XVR_DEFINE_REGISTRY(xveearr::IWindowSystem)
 XVR_DEFINE_REGISTRY(xveearr::IController)
@@ -77,30 +104,122 @@ struct RenderPass
 	};
 };
 
-static const uint32_t gClearColor = 0x303030ff;
+struct TextureFormatName
+{
+	const char* mName;
+	bgfx::TextureFormat::Enum mFormat;
+};
+
+static const TextureFormatName gTextureFormats[] =
+{
+	{ "bgra8", bgfx::TextureFormat::BGRA8 },
+	{ "rgba8", bgfx::TextureFormat::RGBA8 },
+	{ "rgb10a2", bgfx::TextureFormat::RGB10A2 },
+	{ "rgba16f", bgfx::TextureFormat::RGBA16F },
+	{ "d16", bgfx::TextureFormat::D16 },
+	{ "d16f", bgfx::TextureFormat::D16F },
+	{ "d24", bgfx::TextureFormat::D24 },
+	{ "d24s8", bgfx::TextureFormat::D24S8 },
+	{ "d32f", bgfx::TextureFormat::D32F }
+};
+
+struct RendererName
+{
+	const char* mName;
+	bgfx::RendererType::Enum mType;
+};
 
-struct WindowGroup
+static const RendererName gRenderers[] =
 {
-	std::list<WindowId> mMembers;
-	float mTransform[16];
+	{ "auto", bgfx::RendererType::Count },
+	{ "null", bgfx::RendererType::Null },
+	{ "opengl", bgfx::RendererType::OpenGL },
+	{ "opengles", bgfx::RendererType::OpenGLES }
 };
 
+static const float gFullTexRect[] = { 0.f, 0.f, 1.f, 1.f };
+static const double gDefaultRefreshRate = 60.0;
+static const uint32_t gClearColor = 0x303030ff;
+static const unsigned int gWindowEventBatchSize = 256;
+static const unsigned int gMaxTransformBatches = 64;
+static const unsigned int gMinTransformBatchSize = 32;
+// Frames shown by the profiler's frame time graph
+static const unsigned int gGraphWidth = 64;
+static const unsigned int gGraphHeight = 8;
+// In seconds, around the usual refresh intervals
+static const double gFrameTimeBuckets[] = {
+	0.004, 0.007, 0.009, 0.012, 0.014, 0.017, 0.021, 0.034, 0.05, 0.1, 0.25
+};
+
+static Histogram gFrameTimeMetric(
+	"xveearr_frame_time_seconds", "Time between submitted frames",
+	gFrameTimeBuckets, BX_COUNTOF(gFrameTimeBuckets)
+);
+static Gauge gWindowsMetric("xveearr_windows", "Mirrored windows");
+static Gauge gWindowGroupsMetric(
+	"xveearr_window_groups", "Groups of windows from the same process"
+);
+static Gauge gTextureBytesMetric(
+	"xveearr_texture_bytes", "Estimated size of the window textures"
+);
+
 }
 
 class Application: IWindowManager
 {
+	struct TransformBatch
+	{
+		Application* mApp;
+		unsigned int mBegin;
+		unsigned int mEnd;
+	};
+
+	struct ControllerUpdate
+	{
+		IController* mController;
+		unsigned int mMarker;
+	};
+
+	// A timed step of init, either run as a job or inline on the main thread
+	struct StartupTask
+	{
+		typedef bool(*Fn)(Application& app, void* component);
+
+		Application* mApp;
+		Fn mFn;
+		void* mComponent;
+		const char* mName;
+		const char* mComponentName;
+		JobSystem::Job* mJob;
+		int64_t mStart;
+		int64_t mEnd;
+		bool mSucceeded;
+	};
+
 public:
 	Application()
 		:mHMD(NULL)
 		,mWindow(NULL)
 		,mBgfxInitialized(false)
 		,mWindowSystem(NULL)
+		,mSceneChanged(false)
+		,mStartTime(0)
+		,mStartupReported(false)
+		,mLastPoseRecordTime(0)
+		,mBenchJsonPath(NULL)
+		,mShowProfiler(false)
+		,mMainFrameAllocations(0)
+		,mRenderFrameAllocations(0)
+		,mWorkerFrameAllocations(0)
+		,mRenderAllocations(0)
 	{
 		mQuad = BGFX_INVALID_HANDLE;
 		mQuadIndices = BGFX_INVALID_HANDLE;
 		mProgram = BGFX_INVALID_HANDLE;
 		mTextureUniform = BGFX_INVALID_HANDLE;
 		mQuadInfoUniform = BGFX_INVALID_HANDLE;
+		mHeadPoseUniform = BGFX_INVALID_HANDLE;
+		mTexRectUniform = BGFX_INVALID_HANDLE;
 	}
 
 	int run(int argc, char* argv[])
@@ -132,8 +251,9 @@ public:
 
 	unsigned int getWindowGroups(const PID** pids)
 	{
-		*pids = mPIDs.data();
-		return (unsigned int)mPIDs.size();
+		const std::vector<PID>& groupPIDs = mWindowGroups.getPIDs();
+		*pids = groupPIDs.data();
+		return (unsigned int)groupPIDs.size();
 	}
 
 	unsigned int getWindows(PID pid, const WindowId** wids)
@@ -142,12 +262,12 @@ public:
 
 		if(pid)
 		{
-			auto itr = mWindowGroups.find(pid);
-			if(itr != mWindowGroups.end())
+			const WindowGroup* group = mWindowGroups.find(pid);
+			if(group != NULL)
 			{
 				std::copy(
-					itr->second.mMembers.begin(),
-					itr->second.mMembers.end(),
+					group->mMembers.begin(),
+					group->mMembers.end(),
 					std::back_inserter(mTmpWindows)
 				);
 			}
@@ -166,19 +286,20 @@ public:
 
 	bool getGroupTransform(PID pid, float* result)
 	{
-		auto itr = mWindowGroups.find(pid);
-		XVR_ENSURE(itr != mWindowGroups.end(), "Invalid PID");
+		const WindowGroup* group = mWindowGroups.find(pid);
+		XVR_ENSURE(group != NULL, "Invalid PID");
 
-		memcpy(result, itr->second.mTransform, sizeof(itr->second.mTransform));
+		memcpy(result, group->mTransform, sizeof(group->mTransform));
 		return true;
 	}
 
 	bool setGroupTransform(PID pid, const float* mtx)
 	{
-		auto itr = mWindowGroups.find(pid);
-		XVR_ENSURE(itr != mWindowGroups.end(), "Invalid PID");
+		WindowGroup* group = mWindowGroups.find(pid);
+		XVR_ENSURE(group != NULL, "Invalid PID");
 
-		memcpy(itr->second.mTransform, mtx, sizeof(itr->second.mTransform));
+		memcpy(group->mTransform, mtx, sizeof(group->mTransform));
+		mSceneChanged = true;
 		return true;
 	}
 
@@ -186,20 +307,10 @@ public:
 		PID pid, unsigned int x, unsigned int y, float* out
 	)
 	{
-		auto itr = mWindowGroups.find(pid);
-		XVR_ENSURE(itr != mWindowGroups.end(), "Invalid PID");
+		const WindowGroup* group = mWindowGroups.find(pid);
+		XVR_ENSURE(group != NULL, "Invalid PID");
 
-		float pos[] = {
-			(float)x * mXPixelsToMeters - mHalfScreenWidth,
-			-((float)y * mYPixelsToMeters - mHalfScreenHeight),
-			0.f,
-			1.f
-		};
-		float result[4];
-		bx::vec4MulMtx(result, pos, itr->second.mTransform);
-		out[0] = result[0];
-		out[1] = result[1];
-		out[2] = result[2];
+		mDesktopSpace.transformPoint(group->mTransform, (float)x, (float)y, out);
 
 		return true;
 	}
@@ -208,6 +319,7 @@ public:
 	{
 		if(window == 0 || mWindows.find(window) != mWindows.end())
 		{
+			mSceneChanged |= window != mFocusedWindow;
 			mFocusedWindow = window;
 			return true;
 		}
@@ -236,12 +348,90 @@ private:
 	{
 		printf("Usage: xveearr --help\n");
 		printf("       xveearr --version\n");
-		printf("       xveearr [ --log <Level> ] [ --hmd <HMD> ]\n");
+		printf("       xveearr [ --log <Level> ] [ --hmd <HMD> ] [ --jobs <N> ]\n");
+		printf("               [ --full-rate ] [ --eye-size <W>x<H> ]\n");
+		printf("               [ --eye-format <Format> ] [ --eye-depth-format <Format> ]\n");
+		printf("               [ --dynamic-resolution ] [ --record-head <File> ]\n");
+		printf("               [ --replay-file <File> ] [ --replay-rate <Hz> ]\n");
+		printf("               [ --winsys <WindowSystem> ] [ --renderer <Renderer> ]\n");
+		printf("               [ --synthetic-windows <N> ] [ --synthetic-groups <N> ]\n");
+		printf("               [ --synthetic-distribution <Distribution> ]\n");
+		printf("               [ --synthetic-min-size <W>x<H> ]\n");
+		printf("               [ --synthetic-max-size <W>x<H> ]\n");
+		printf("               [ --synthetic-churn-rate <N> ]\n");
+		printf("               [ --synthetic-resize-rate <N> ]\n");
+		printf("               [ --synthetic-update-rate <N> ]\n");
+		printf("               [ --synthetic-seed <N> ] [ --record-events <File> ]\n");
+		printf("               [ --replay-events <File> ]\n");
+		printf("               [ --replay-speed <original|max> ]\n");
+		printf("               [ --bench <Seconds> ] [ --bench-json <File> ]\n");
+		printf("               [ --bench-allow-alloc ]\n");
+		printf("               [ --hidden ] [ --profiler ] [ --trace <File> ]\n");
+		printf("               [ --metrics <Socket> ] [ --x-slow-ms <Milliseconds> ]\n");
 		printf("\n");
 		printf("    --help                  Print this message\n");
 		printf("    -v, --version           Show version info\n");
 		printf("    -h, --hmd <HMD>         Choose HMD driver\n");
 		printf("    -l, --log <Level>       Set log level\n");
+		printf("    -j, --jobs <N>          Number of worker threads\n");
+		printf("    --log-file <File>       Write the log there instead of stdout\n");
+		printf("    --full-rate             Render every frame even when idle\n");
+		printf("    --eye-size <W>x<H>      Size of each eye buffer\n");
+		printf("    --eye-format <Format>   Eye buffer color format\n");
+		printf("                            (bgra8, rgba8, rgb10a2, rgba16f)\n");
+		printf("    --eye-depth-format <Format>\n");
+		printf("                            Eye buffer depth format\n");
+		printf("                            (d16, d16f, d24, d24s8, d32f)\n");
+		printf("    --dynamic-resolution    Lower the eye buffer resolution when\n");
+		printf("                            frames take too long\n");
+		printf("    --record-head <File>    Record head motion for the replay HMD\n");
+		printf("    --replay-file <File>    Head motion played back by the replay HMD\n");
+		printf("    --replay-rate <Hz>      Replay updates per recorded second\n");
+		printf("    --winsys <WindowSystem> Choose window system, synthetic ones\n");
+		printf("                            are only used when chosen\n");
+		printf("    --renderer <Renderer>   Choose bgfx renderer\n");
+		printf("                            (auto, null, opengl, opengles)\n");
+		printf("    --synthetic-windows <N> Number of synthetic windows\n");
+		printf("    --synthetic-groups <N>  Number of groups they are spread over\n");
+		printf("    --synthetic-distribution <Distribution>\n");
+		printf("                            How windows are spread over groups\n");
+		printf("                            (round-robin, uniform, zipf[:<S>]),\n");
+		printf("                            with zipf group K gets a share of\n");
+		printf("                            1/K^S (default S: 1)\n");
+		printf("    --synthetic-min-size <W>x<H>\n");
+		printf("    --synthetic-max-size <W>x<H>\n");
+		printf("                            Range of synthetic window sizes\n");
+		printf("    --synthetic-churn-rate <N>\n");
+		printf("                            Windows mapped or unmapped per second\n");
+		printf("    --synthetic-resize-rate <N>\n");
+		printf("                            Windows resized per second\n");
+		printf("    --synthetic-update-rate <N>\n");
+		printf("                            Window contents updated per second\n");
+		printf("    --synthetic-seed <N>    Seed for synthetic window activity\n");
+		printf("    --record-events <File>  Record window events for the replay\n");
+		printf("                            window system\n");
+		printf("    --replay-events <File>  Window events played back by the replay\n");
+		printf("                            window system\n");
+		printf("    --replay-speed <original|max>\n");
+		printf("                            Keep the recorded timing or return a\n");
+		printf("                            recorded batch on every poll\n");
+		printf("    --bench <Seconds>       Render without vsync for the given time\n");
+		printf("                            then print frame statistics and exit\n");
+		printf("    --bench-json <File>     Write the statistics there instead of\n");
+		printf("                            stdout\n");
+		printf("    --bench-allow-alloc     Do not fail the benchmark when a frame\n");
+		printf("                            allocates once warmed up\n");
+		printf("    --hidden                Do not show the mirror window\n");
+		printf("    --profiler              Show the profiler, F3 on the mirror\n");
+		printf("                            window toggles it\n");
+		printf("    --trace <File>          Write a Chrome trace of every thread\n");
+		printf("                            there at exit, F4 on the mirror window\n");
+		printf("                            writes it right away\n");
+		printf("    --metrics <Socket>      Serve Prometheus metrics on a UNIX\n");
+		printf("                            domain socket\n");
+		printf("    --x-slow-ms <Milliseconds>\n");
+		printf("                            Log X round trips slower than this\n");
+		printf("                            (default: 5)\n");
 
 		return EXIT_SUCCESS;
 	}
@@ -279,6 +469,7 @@ private:
 
 	bool init(int argc, char* argv[])
 	{
+		mStartTime = bx::getHPCounter();
 		bx::CommandLine cmdLine(argc, argv);
 
 		const char* logLevelStr = cmdLine.findOption('l', "log", "info");
@@ -286,8 +477,98 @@ private:
 		XVR_ENSURE(logLevel < Log::Count, "Invalid log level: ", logLevelStr);
 		Log::setLogLevel(logLevel);
 
+		const char* logPath = cmdLine.findOption("log-file");
+		if(logPath)
+		{
+			mLogFile.open(logPath);
+			XVR_ENSURE(mLogFile.is_open(), "Could not open ", logPath, " for writing");
+			Log::setOutputStream(mLogFile);
+		}
+		// Lines are written by a background thread from now on
+		Log::startAsync();
+
+		Trace::setThreadName("Main thread");
+		// Worker threads record from the start
+		const char* tracePath = cmdLine.findOption("trace");
+		if(tracePath)
+		{
+			XVR_ENSURE(Trace::init(tracePath), "Could not start tracing");
+		}
+
+		unsigned int numCores = std::thread::hardware_concurrency();
+		unsigned int numWorkers = numCores > 1 ? numCores - 1 : 0;
+		const char* numWorkersStr = cmdLine.findOption('j', "jobs");
+		if(numWorkersStr) { numWorkers = (unsigned int)atoi(numWorkersStr); }
+		XVR_ENSURE(mJobSystem.init(numWorkers), "Could not start job system");
+
+		const char* metricsPath = cmdLine.findOption("metrics");
+		if(metricsPath)
+		{
+			XVR_ENSURE(
+				mMetricsServer.init(metricsPath),
+				"Could not start metrics server"
+			);
+		}
+
+		const char* benchStr = cmdLine.findOption("bench");
+		if(benchStr)
+		{
+			double benchDuration = atof(benchStr);
+			XVR_ENSURE(benchDuration > 0.0, "Invalid benchmark duration: ", benchStr);
+			mBenchmark.init(benchDuration, !cmdLine.hasArg("bench-allow-alloc"));
+			mBenchJsonPath = cmdLine.findOption("bench-json");
+		}
+
 		const char* hmdName = cmdLine.findOption('h', "hmd", "null");
 
+		// Only read by HMD init, which is waited for below
+		mHMDCfg.mCmdLine = &cmdLine;
+		mHMDCfg.mEyeWidth = 0;
+		mHMDCfg.mEyeHeight = 0;
+		const char* eyeSizeStr = cmdLine.findOption("eye-size");
+		if(eyeSizeStr)
+		{
+			XVR_ENSURE(
+				sscanf(
+					eyeSizeStr, "%ux%u", &mHMDCfg.mEyeWidth, &mHMDCfg.mEyeHeight
+				) == 2 && mHMDCfg.mEyeWidth > 0 && mHMDCfg.mEyeHeight > 0,
+				"Invalid eye buffer size: ", eyeSizeStr
+			);
+		}
+
+		const char* colorFormatStr = cmdLine.findOption("eye-format");
+		mHMDCfg.mColorFormat = parseTextureFormat(colorFormatStr);
+		XVR_ENSURE(
+			mHMDCfg.mColorFormat != bgfx::TextureFormat::Unknown,
+			"Invalid eye buffer format: ", colorFormatStr
+		);
+
+		const char* depthFormatStr = cmdLine.findOption("eye-depth-format");
+		mHMDCfg.mDepthFormat = parseTextureFormat(depthFormatStr);
+		XVR_ENSURE(
+			mHMDCfg.mDepthFormat != bgfx::TextureFormat::Unknown,
+			"Invalid eye buffer depth format: ", depthFormatStr
+		);
+
+		bool dynamicResolution = cmdLine.hasArg("dynamic-resolution");
+		mShowProfiler = cmdLine.hasArg("profiler");
+
+		const char* rendererStr = cmdLine.findOption("renderer", "auto");
+		bgfx::RendererType::Enum rendererType = bgfx::RendererType::Count;
+		bool rendererFound = false;
+		for(const RendererName& renderer: gRenderers)
+		{
+			if(bx::stricmp(renderer.mName, rendererStr) == 0)
+			{
+				rendererType = renderer.mType;
+				rendererFound = true;
+				break;
+			}
+		}
+		XVR_ENSURE(rendererFound, "Invalid renderer: ", rendererStr);
+
+		const char* winsysName = cmdLine.findOption("winsys");
+
 		XVR_LOG(Info, "Looking for HMD driver");
 		for(IHMD& hmd: Registry<IHMD>::all())
 		{
@@ -300,76 +581,192 @@ private:
 		}
 
 		XVR_ENSURE(mHMD != NULL, "Could not find HMD driver");
-		XVR_ENSURE(mHMD->init(), "Could no initialize HMD");
 
+		// Benchmarks measure every frame the renderer can produce. Replayed
+		// head motion advances once per update, skipped frames would make
+		// what is shown depend on timing.
+		mFrameScheduler.init(
+			bx::getHPCounter(),
+			!cmdLine.hasArg("full-rate")
+				&& !mBenchmark.isEnabled()
+				&& !mHMD->isReplay()
+		);
+
+#if BX_PLATFORM_LINUX == 1
+		// Window systems probe and bind textures from other threads, some
+		// of them through SDL's display connection
+		XInitThreads();
+#endif
+
+		// Everything which does not need the SDL window runs while SDL
+		// starts up
+		mJobSystem.reset();
+		StartupTask& hmdTask =
+			spawnStartupTask("init", mHMD->getName(), initHMD, mHMD);
+		for(IWindowSystem& winsys: Registry<IWindowSystem>::all())
+		{
+			bool chosen = winsysName
+				? strcmp(winsys.getName(), winsysName) == 0
+				: !winsys.isSynthetic();
+			if(!chosen) { continue; }
+
+			spawnStartupTask(
+				"probe", winsys.getName(), probeWindowSystem, &winsys
+			);
+		}
+
+		StartupTask& sdlTask = beginStartupPhase("SDL init");
 		SDL_SetMainReady();
 		XVR_ENSURE(
 			SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) == 0,
 			"Could not initialize SDL"
 		);
+		endStartupPhase(sdlTask);
+
+		mJobSystem.wait(hmdTask.mJob);
+		mHMDCfg.mCmdLine = NULL;
+		XVR_ENSURE(hmdTask.mSucceeded, "Could no initialize HMD");
+
+		const char* recordHeadPath = cmdLine.findOption("record-head");
+		if(recordHeadPath)
+		{
+			XVR_ENSURE(
+				mPoseWriter.open(recordHeadPath),
+				"Could not start recording head motion"
+			);
+			XVR_LOG(Info, "Recording head motion to ", recordHeadPath);
+		}
 
 		unsigned int viewportWidth, viewportHeight;
 		mHMD->getViewportSize(viewportWidth, viewportHeight);
 
+		StartupTask& windowTask = beginStartupPhase("create window");
 		mWindow = SDL_CreateWindow(
 			"Xveearr",
 			SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
 			viewportWidth * 2, viewportHeight,
-			SDL_WINDOW_SHOWN
+			cmdLine.hasArg("hidden") ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN
 		);
-
+		endStartupPhase(windowTask);
 		XVR_ENSURE(mWindow, "Could not create window");
 
+		SDL_DisplayMode displayMode;
+		double refreshRate = gDefaultRefreshRate;
+		if(SDL_GetWindowDisplayMode(mWindow, &displayMode) == 0
+			&& displayMode.refresh_rate > 0)
+		{
+			refreshRate = displayMode.refresh_rate;
+		}
+		mDynamicResolution.init(dynamicResolution, refreshRate);
+
 		XVR_LOG(Info, "Looking for WindowSystem");
+		StartupTask& winsysTask = beginStartupPhase("window system");
 		WindowSystemCfg wndSysCfg;
 		wndSysCfg.mWindow = mWindow;
-		for(IWindowSystem& winsys: Registry<IWindowSystem>::all())
+		wndSysCfg.mWindowTable = &mWindows;
+		wndSysCfg.mCmdLine = &cmdLine;
+		// Probes are checked in registration order so the preference order
+		// stays the same
+		for(StartupTask& task: mStartupTasks)
 		{
-			XVR_LOG(Info, "Trying ", winsys.getName());
-			if(winsys.init(wndSysCfg))
-			{
-				XVR_LOG(Info, "Use ", winsys.getName());
-				mWindowSystem = &winsys;
-				break;
-			}
-			else
+			if(task.mFn != probeWindowSystem) { continue; }
+
+			mJobSystem.wait(task.mJob);
+			IWindowSystem* winsys = static_cast<IWindowSystem*>(task.mComponent);
+			if(!task.mSucceeded || mWindowSystem) { continue; }
+
+			XVR_LOG(Info, "Trying ", winsys->getName());
+			if(winsys->init(wndSysCfg))
 			{
-				winsys.shutdown();
+				XVR_LOG(Info, "Use ", winsys->getName());
+				mWindowSystem = winsys;
 			}
 		}
+		shutdownProbedWindowSystems();
+		endStartupPhase(winsysTask);
 
 		XVR_ENSURE(mWindowSystem, "Could not find a suitable WindowSystem");
 
+		const char* recordEventsPath = cmdLine.findOption("record-events");
+		if(recordEventsPath)
+		{
+			XVR_ENSURE(
+				mEventRecorder.open(mWindowSystem, recordEventsPath),
+				"Could not record window events"
+			);
+			mWindowSystem = &mEventRecorder;
+		}
+
 		XVR_LOG(Info, "Initializing Controller(s)");
-		ControllerCfg controllerCfg;
-		controllerCfg.mWindow = mWindow;
-		controllerCfg.mWindowManager = this;
-		controllerCfg.mHMD = mHMD;
+		mControllerCfg.mWindow = mWindow;
+		mControllerCfg.mWindowManager = this;
+		mControllerCfg.mHMD = mHMD;
+		// On the main thread, controllers call into SDL's video subsystem
+		// which is not thread-safe
 		for(IController& controller: Registry<IController>::all())
 		{
-			XVR_LOG(Info, "Trying ", controller.getName());
-			if(controller.init(controllerCfg))
-			{
-				XVR_LOG(Info, "Use ", controller.getName());
-				mControllers.push_back(&controller);
-			}
-			else
-			{
-				controller.shutdown();
-			}
+			StartupTask& task = addStartupTask(
+				"init", controller.getName(), initController, &controller
+			);
+			runStartupTask(&task);
+			if(!task.mSucceeded) { continue; }
+
+			XVR_LOG(Info, "Use ", controller.getName());
+			mControllers.push_back(&controller);
+
+			char markerName[32];
+			snprintf(
+				markerName, sizeof(markerName),
+				"%s controller", controller.getName()
+			);
+			ControllerUpdate update;
+			update.mController = &controller;
+			update.mMarker = Profiler::registerMarker(markerName);
+			mControllerUpdates.push_back(update);
 		}
 
+		mLateLatch.init(mHMD, &mFrameScheduler);
+		mReprojection.init(mHMD, &mLateLatch, &mFrameScheduler);
+
+		StartupTask& renderThreadTask = beginStartupPhase("render thread");
 		mRenderThread.init(renderThread, this, 0, "Render thread");
 		mRenderThreadReadySem.wait();
+		endStartupPhase(renderThreadTask);
 
+		StartupTask& bgfxTask = beginStartupPhase("bgfx init");
 		bgfx::sdlSetWindow(mWindow);
-		XVR_ENSURE(bgfx::init(), "Could not initialize bgfx");
-		mBgfxInitialized = true;
+		mBgfxInitialized = bgfx::init(rendererType);
+		endStartupPhase(bgfxTask);
+
+		waitStartupTasks();
+
+		XVR_ENSURE(mBgfxInitialized, "Could not initialize bgfx");
+
+		StartupTask& resourcesTask = beginStartupPhase("resources");
 
 		mHMD->prepareResources();
 		mHMD->update();
+		// The render thread would latch whichever replayed pose is current,
+		// which depends on timing. Reprojection is off along with it.
+		if(mHMD->isReplay())
+		{
+			XVR_LOG(Info, "Late latching is off while replaying head motion");
+		}
+		else
+		{
+			mLateLatch.prepareResources();
+		}
+		// Reprojected frames would skew the benchmark's frame times
+		if(!mBenchmark.isEnabled())
+		{
+			mReprojection.prepareResources(viewportWidth * 2, viewportHeight);
+		}
+		mHMD->getHeadTransform(mLastHeadTransform);
 
-		bgfx::reset(viewportWidth * 2, viewportHeight, BGFX_RESET_VSYNC);
+		bgfx::reset(
+			viewportWidth * 2, viewportHeight,
+			mBenchmark.isEnabled() ? BGFX_RESET_NONE : BGFX_RESET_VSYNC
+		);
 		bgfx::setDebug(BGFX_DEBUG_TEXT);
 
 		DisplayMetrics displayMetrics = mWindowSystem->getDisplayMetrics();
@@ -378,15 +775,14 @@ private:
 		XVR_LOG(Debug, "Width in meters = ", displayMetrics.mWidthInMeters);
 		XVR_LOG(Debug, "Height in meters = ", displayMetrics.mHeightInMeters);
 
-		mHalfScreenWidth = displayMetrics.mWidthInMeters * 0.5f;
-		mHalfScreenHeight = displayMetrics.mHeightInMeters * 0.5f;
-		mXPixelsToMeters = displayMetrics.mWidthInMeters / (float)displayMetrics.mWidthInPixels;
-		mYPixelsToMeters = displayMetrics.mHeightInMeters / (float)displayMetrics.mHeightInPixels;
+		mDesktopSpace.init(displayMetrics);
 
 		float hmdAspectRatio = (float)viewportWidth / (float)viewportHeight;
 		float destkopAspectRatio = (float)displayMetrics.mWidthInMeters / (float)displayMetrics.mHeightInMeters;
 		bool fitWidth = destkopAspectRatio > hmdAspectRatio;
-		float halfFitDim = fitWidth ? mHalfScreenWidth : mHalfScreenHeight;
+		float halfFitDim = 0.5f * (fitWidth
+			? displayMetrics.mWidthInMeters
+			: displayMetrics.mHeightInMeters);
 
 		const RenderData& eye = mHMD->getRenderData(Eye::Left);
 		float wat = eye.mViewProjection[5];
@@ -453,6 +849,13 @@ private:
 		mQuadInfoUniform = bgfx::createUniform(
 			"u_quadInfo", bgfx::UniformType::Vec4
 		);
+		mHeadPoseUniform = bgfx::createUniform(
+			"u_headPose", bgfx::UniformType::Int1
+		);
+		mTexRectUniform = bgfx::createUniform(
+			"u_texRect", bgfx::UniformType::Vec4
+		);
+		endStartupPhase(resourcesTask);
 
 		return true;
 	}
@@ -460,6 +863,12 @@ private:
 	void shutdown()
 	{
 		XVR_LOG(Info, "Shutting down...");
+		// init can fail while startup tasks are still running
+		waitStartupTasks();
+		shutdownProbedWindowSystems();
+
+		if(bgfx::isValid(mTexRectUniform)) { bgfx::destroyUniform(mTexRectUniform); }
+		if(bgfx::isValid(mHeadPoseUniform)) { bgfx::destroyUniform(mHeadPoseUniform); }
 		if(bgfx::isValid(mQuadInfoUniform)) { bgfx::destroyUniform(mQuadInfoUniform); }
 		if(bgfx::isValid(mTextureUniform)) { bgfx::destroyUniform(mTextureUniform); }
 		if(bgfx::isValid(mProgram)) { bgfx::destroyProgram(mProgram); }
@@ -468,6 +877,8 @@ private:
 
 		if(mBgfxInitialized)
 		{
+			mReprojection.releaseResources();
+			mLateLatch.releaseResources();
 			mHMD->releaseResources();
 			bgfx::shutdown();
 		}
@@ -484,8 +895,19 @@ private:
 		if(mWindow) { SDL_DestroyWindow(mWindow); }
 		SDL_Quit();
 
+		mPoseWriter.close();
 		if(mHMD) { mHMD->shutdown(); }
+		mJobSystem.shutdown();
+		mMetricsServer.shutdown();
+		// Every other thread is gone
+		Trace::shutdown();
 		XVR_LOG(Info, "Shutdown completed");
+		Log::stopAsync();
+		if(mLogFile.is_open())
+		{
+			Log::setOutputStream(std::cout);
+			mLogFile.close();
+		}
 	}
 
 	int mainLoop()
@@ -501,54 +923,173 @@ private:
 			rightImageTransform, (float)viewportWidth, (float)viewportHeight, 0.f
 		);
 
+		// bgfx puts the view rect at the top of the frame buffer, which is
+		// the end of the texture when rows start at the bottom
+		bgfx::RendererType::Enum rendererType = bgfx::getRendererType();
+		bool originBottomLeft = rendererType == bgfx::RendererType::OpenGL
+			|| rendererType == bgfx::RendererType::OpenGLES;
+
+		if(mBenchmark.isEnabled()) { mBenchmark.start(bx::getHPCounter()); }
+
+		static const unsigned int submitMarker =
+			Profiler::registerMarker("submit");
+		static const unsigned int gpuFrameMarker =
+			Profiler::registerMarker("gpu frame");
+		int64_t lastFrameTime = 0;
+		uint64_t lastMainAllocations = AllocationCounter::getThreadAllocations();
+		uint64_t lastRenderAllocations = mRenderAllocations;
+		uint64_t lastWorkerAllocations = mJobSystem.getWorkerAllocations();
+
 		while(true)
 		{
-			SDL_Event sdlEvent;
-			while(SDL_PollEvent(&sdlEvent))
-			{
-				if(sdlEvent.type == SDL_QUIT) { return 0; }
-			}
+			int64_t now = bx::getHPCounter();
 
-			WindowEvent windowEvent;
-			while(mWindowSystem->pollEvent(windowEvent))
 			{
-				switch(windowEvent.mType)
+				XVR_PROFILE_SCOPE("sdl events");
+
+				SDL_Event sdlEvent;
+				while(SDL_PollEvent(&sdlEvent))
 				{
-					case WindowEvent::WindowAdded:
-						onWindowAdded(windowEvent);
-						break;
-					case WindowEvent::WindowRemoved:
-						onWindowRemoved(windowEvent);
-						break;
-					case WindowEvent::WindowUpdated:
-						onWindowUpdated(windowEvent);
-						break;
+					if(sdlEvent.type == SDL_QUIT) { return 0; }
+
+					if(sdlEvent.type == SDL_KEYDOWN
+						&& sdlEvent.key.keysym.scancode == SDL_SCANCODE_F3
+						&& !sdlEvent.key.repeat)
+					{
+						mShowProfiler = !mShowProfiler;
+					}
+
+					if(sdlEvent.type == SDL_KEYDOWN
+						&& sdlEvent.key.keysym.scancode == SDL_SCANCODE_F4
+						&& !sdlEvent.key.repeat)
+					{
+						Trace::flush();
+					}
+
+					// Input usually moves the head or the windows
+					mFrameScheduler.notifyMotion(now);
 				}
 			}
 
-			mHMD->update();
+			processWindowEvents(now);
 
-			for(IController* controller: mControllers)
+			mJobSystem.reset();
+
+			mHMD->pollInput();
+			JobSystem::Job* lastJob = mJobSystem.create(
+				"hmd update", updateHMD, this
+			);
+			mJobSystem.schedule(lastJob);
+
+			// Controllers share the window manager so they run in order
+			for(ControllerUpdate& update: mControllerUpdates)
 			{
-				controller->update();
+				JobSystem::Job* controllerJob = mJobSystem.create(
+					update.mController->getName(), updateController, &update
+				);
+				mJobSystem.addDependency(controllerJob, lastJob);
+				mJobSystem.schedule(controllerJob);
+				lastJob = controllerJob;
 			}
 
+			mJobSystem.wait(lastJob);
+
+			float headTransform[16];
+			mHMD->getHeadTransform(headTransform);
+			if(mPoseWriter.isOpen())
+			{
+				int64_t recordTime = bx::getHPCounter();
+				float deltaTime = mLastPoseRecordTime == 0
+					? 0.f
+					: (float)(recordTime - mLastPoseRecordTime)
+						/ (float)bx::getHPFrequency();
+				mPoseWriter.write(headTransform, deltaTime);
+				mLastPoseRecordTime = recordTime;
+			}
+
+			if(memcmp(headTransform, mLastHeadTransform, sizeof(headTransform)))
+			{
+				memcpy(mLastHeadTransform, headTransform, sizeof(headTransform));
+				mSceneChanged = true;
+			}
+
+			now = bx::getHPCounter();
+			if(mSceneChanged)
+			{
+				mFrameScheduler.notifyMotion(now);
+				mSceneChanged = false;
+			}
+
+			FrameScheduler::Mode::Enum mode = mFrameScheduler.update(now);
+			// Below full rate the render thread must not fill in frames
+			mReprojection.setArmed(mode == FrameScheduler::Mode::Full);
+			if(!mFrameScheduler.shouldRender(now))
+			{
+				mWindowSystem->waitEvent(mFrameScheduler.getWaitTime(now));
+				// Idle iterations are not charged to the next frame
+				lastMainAllocations = AllocationCounter::getThreadAllocations();
+				lastRenderAllocations = mRenderAllocations;
+				lastWorkerAllocations = mJobSystem.getWorkerAllocations();
+				continue;
+			}
+
+			{
+				XVR_PROFILE_SCOPE("transforms");
+
+				unsigned int numTransformBatches = scheduleTransforms();
+				for(unsigned int i = 0; i < numTransformBatches; ++i)
+				{
+					mJobSystem.wait(mTransformJobs[i]);
+				}
+			}
+
+			int64_t submitStart = bx::getHPCounter();
+
+			int64_t displayTime = mFrameScheduler.getDisplayTime(now);
+			float predictedHeadTransform[16];
+			mHMD->getPredictedHeadTransform(displayTime, predictedHeadTransform);
+
+			// With late latching the render thread applies the head pose and
+			// the views only hold the eye offsets
+			bool lateLatched = mLateLatch.isEnabled();
+			if(lateLatched) { bx::mtxIdentity(predictedHeadTransform); }
+
+			float leftView[16];
+			mHMD->getViewTransform(Eye::Left, predictedHeadTransform, leftView);
 			const RenderData& leftEye = mHMD->getRenderData(Eye::Left);
 			bgfx::setViewTransform(
-				RenderPass::LeftEye,
-				leftEye.mViewTransform,
-				leftEye.mViewProjection
+				RenderPass::LeftEye, leftView, leftEye.mViewProjection
 			);
 
+			float rightView[16];
+			mHMD->getViewTransform(Eye::Right, predictedHeadTransform, rightView);
 			const RenderData& rightEye = mHMD->getRenderData(Eye::Right);
 			bgfx::setViewTransform(
-				RenderPass::RightEye,
-				rightEye.mViewTransform,
-				rightEye.mViewProjection
+				RenderPass::RightEye, rightView, rightEye.mViewProjection
 			);
 
+			// Only a part of the eye buffers is rendered and sampled
+			float renderScale = mDynamicResolution.getScale();
+			uint16_t eyeWidth = (uint16_t)bx::fmax(
+				1.f, bx::fround(viewportWidth * renderScale)
+			);
+			uint16_t eyeHeight = (uint16_t)bx::fmax(
+				1.f, bx::fround(viewportHeight * renderScale)
+			);
+			bgfx::setViewRect(RenderPass::LeftEye, 0, 0, eyeWidth, eyeHeight);
+			bgfx::setViewRect(RenderPass::RightEye, 0, 0, eyeWidth, eyeHeight);
+			float texScaleX = (float)eyeWidth / (float)viewportWidth;
+			float texScaleY = (float)eyeHeight / (float)viewportHeight;
+			float eyeTexRect[] = {
+				0.f, originBottomLeft ? 1.f - texScaleY : 0.f,
+				texScaleX, texScaleY
+			};
+
 			bgfx::touch(RenderPass::LeftEye);
 			bgfx::touch(RenderPass::RightEye);
+			unsigned int drawItemIndex = 0;
+			// bgfx's stats do not count draw calls
+			unsigned int numDrawCalls = 0;
 			for(auto&& pair: mWindowGroups)
 			{
 				const WindowGroup& group = pair.second;
@@ -558,28 +1099,24 @@ private:
 				for(WindowId window: group.mMembers)
 				{
 					focused |= window == mFocusedWindow;
-					const WindowInfo& wndInfo = mWindows[window];
-
-					float relTransform[16];
-					bx::mtxTranslate(relTransform,
-						(float)wndInfo.mX * mXPixelsToMeters - mHalfScreenWidth,
-						-((float)wndInfo.mY * mYPixelsToMeters - mHalfScreenHeight),
-						zOrder);
-					float transform[16];
-					bx::mtxMul(transform, relTransform, group.mTransform);
+					const DrawItem& drawItem = mDrawItems[drawItemIndex++];
+					const WindowInfo& wndInfo = *drawItem.mInfo;
 
 					bgfx::setState(BGFX_STATE_DEFAULT & ~BGFX_STATE_CULL_MASK);
 					loadTexturedQuad(
-						transform,
+						drawItem.mTransform,
 						wndInfo.mTexture,
-						wndInfo.mWidth * mXPixelsToMeters,
-						wndInfo.mHeight * mYPixelsToMeters,
-						wndInfo.mInvertedY
+						mDesktopSpace.getWidthInMeters((float)wndInfo.mWidth),
+						mDesktopSpace.getHeightInMeters((float)wndInfo.mHeight),
+						wndInfo.mInvertedY,
+						lateLatched,
+						gFullTexRect
 					);
 					bgfx::submit(RenderPass::LeftEye, mProgram, 0, true);
 					bgfx::submit(RenderPass::RightEye, mProgram, 0, false);
+					numDrawCalls += 2;
 
-					zOrder += 0.0001f;
+					zOrder = drawItem.mZOrder + 0.0001f;
 				}
 
 				if(!focused) { continue; }
@@ -587,120 +1124,560 @@ private:
 				CursorInfo cursorInfo = mWindowSystem->getCursorInfo();
 				int mouseX, mouseY;
 				SDL_GetGlobalMouseState(&mouseX, &mouseY);
-				float cursorRelTransform[16];
-				float cursorXInMeters = (mouseX - cursorInfo.mOriginX) * mXPixelsToMeters;
-				float cursorYInMeters = (mouseY - cursorInfo.mOriginY) * mYPixelsToMeters;
-				bx::mtxTranslate(cursorRelTransform,
-					cursorXInMeters - mHalfScreenWidth,
-					-(cursorYInMeters - mHalfScreenHeight),
-					zOrder);
 				float cursorTransform[16];
-				bx::mtxMul(cursorTransform, cursorRelTransform, group.mTransform);
+				mDesktopSpace.getCursorTransform(
+					group.mTransform, mouseX, mouseY, cursorInfo, zOrder,
+					cursorTransform
+				);
 
 				bgfx::setState(BGFX_STATE_DEFAULT | BGFX_STATE_BLEND_ALPHA);
 				loadTexturedQuad(
 					cursorTransform,
 					cursorInfo.mTexture,
-					cursorInfo.mWidth * mXPixelsToMeters,
-					cursorInfo.mHeight * mYPixelsToMeters,
-					true
+					mDesktopSpace.getWidthInMeters((float)cursorInfo.mWidth),
+					mDesktopSpace.getHeightInMeters((float)cursorInfo.mHeight),
+					true,
+					lateLatched,
+					gFullTexRect
 				);
 				bgfx::submit(RenderPass::LeftEye, mProgram, 0, true);
 				bgfx::submit(RenderPass::RightEye, mProgram, 0, false);
+				numDrawCalls += 2;
 			}
 
 			loadTexturedQuad(
 				leftImageTransform,
 				leftEye.mFrameBuffer,
-				(float)viewportWidth, (float)viewportHeight, false
+				(float)viewportWidth, (float)viewportHeight, false, false,
+				eyeTexRect
 			);
 			bgfx::submit(RenderPass::Mirror, mProgram);
 
 			loadTexturedQuad(
 				rightImageTransform,
 				rightEye.mFrameBuffer,
-				(float)viewportWidth, (float)viewportHeight, false
+				(float)viewportWidth, (float)viewportHeight, false, false,
+				eyeTexRect
 			);
 			bgfx::submit(RenderPass::Mirror, mProgram);
+			numDrawCalls += 2;
 
 			bgfx::dbgTextClear();
 			bgfx::dbgTextPrintf(0, 1, 0x4f, "Focused window: %zd", mFocusedWindow);
+			bgfx::dbgTextPrintf(0, 2, 0x0f, "Frame rate: %-7s %5.1f fps",
+				FrameScheduler::getModeName(mFrameScheduler.getMode()),
+				mFrameScheduler.getFrameRate());
+			bgfx::dbgTextPrintf(0, 3, 0x0f, "Reprojected frames: %u",
+				mReprojection.getNumReprojectedFrames());
+			bgfx::dbgTextPrintf(0, 4, 0x0f, "Render scale: %3.0f%%%s",
+				renderScale * 100.f,
+				mDynamicResolution.isEnabled() ? "" : " (fixed)");
+			if(mShowProfiler)
+			{
+				printProfiler(5);
+			}
+			else
+			{
+				printJobTimings(5);
+			}
+
+			int64_t submitEnd = bx::getHPCounter();
+			Profiler::addTime(submitMarker, submitEnd - submitStart);
+			if(Trace::isEnabled())
+			{
+				Trace::addEvent("submit", submitStart, submitEnd);
+			}
+			mReprojection.frameSubmitted();
+			mLatency.frameSubmitted(bx::getHPCounter());
+			{
+				XVR_PROFILE_SCOPE("frame wait");
+				mLateLatch.frameSubmitted(bgfx::frame());
+			}
+			mLatency.update();
+			int64_t frameTime = bx::getHPCounter();
+			mFrameScheduler.frameSubmitted(frameTime);
+			// bgfx's timer queries only bracket the GL work, unlike timing
+			// bgfx::renderFrame which mostly waits for vsync
+			double gpuTime = getLastGpuTime();
+			if(gpuTime > 0.0)
+			{
+				Profiler::addTime(
+					gpuFrameMarker, (int64_t)(gpuTime * bx::getHPFrequency())
+				);
+			}
+			Profiler::endFrame(frameTime);
+			if(lastFrameTime != 0)
+			{
+				gFrameTimeMetric.observe(
+					(double)(frameTime - lastFrameTime) / (double)bx::getHPFrequency()
+				);
+			}
+			lastFrameTime = frameTime;
+
+			if(mode == FrameScheduler::Mode::Full)
+			{
+				mDynamicResolution.update(getLastGpuTime());
+			}
+
+			if(!mStartupReported)
+			{
+				reportStartup(frameTime);
+				mStartupReported = true;
+			}
+
+			uint64_t renderAllocations = mRenderAllocations;
+			uint64_t workerAllocations = mJobSystem.getWorkerAllocations();
+			mMainFrameAllocations =
+				AllocationCounter::getThreadAllocations() - lastMainAllocations;
+			mRenderFrameAllocations = renderAllocations - lastRenderAllocations;
+			mWorkerFrameAllocations = workerAllocations - lastWorkerAllocations;
+			lastRenderAllocations = renderAllocations;
+			lastWorkerAllocations = workerAllocations;
 
-			bgfx::frame();
+			if(mBenchmark.isEnabled())
+			{
+				mBenchmark.addDrawCalls(numDrawCalls);
+				mBenchmark.addAllocations(
+					mMainFrameAllocations, mRenderFrameAllocations,
+					mWorkerFrameAllocations
+				);
+				mBenchmark.frameSubmitted(
+					frameTime, getLastCpuTime(), getLastGpuTime()
+				);
+
+				if(mBenchmark.isFinished(frameTime))
+				{
+					return mBenchmark.report(mBenchJsonPath)
+						? EXIT_SUCCESS
+						: EXIT_FAILURE;
+				}
+			}
+
+			// Bookkeeping above is not part of the next frame
+			lastMainAllocations = AllocationCounter::getThreadAllocations();
 		}
 	}
 
-	template<typename T>
-	void loadTexturedQuad(
-		const float* transform,
-		T texture,
-		float width, float height,
-		bool invertedY
+	void processWindowEvents(int64_t now)
+	{
+		XVR_PROFILE_SCOPE("window events");
+
+		bool windowsChanged = false;
+		unsigned int numWindowEvents;
+		do
+		{
+			numWindowEvents = mWindowSystem->pollEvents(
+				mWindowEvents, BX_COUNTOF(mWindowEvents)
+			);
+
+			for(unsigned int i = 0; i < numWindowEvents; ++i)
+			{
+				const WindowEvent& windowEvent = mWindowEvents[i];
+				// Every kind of event changes what is shown
+				mLatency.contentChanged(windowEvent.mTime);
+				switch(windowEvent.mType)
+				{
+					case WindowEvent::WindowAdded:
+						onWindowAdded(windowEvent);
+						mFrameScheduler.notifyMotion(now);
+						windowsChanged = true;
+						break;
+					case WindowEvent::WindowRemoved:
+						onWindowRemoved(windowEvent);
+						mFrameScheduler.notifyMotion(now);
+						windowsChanged = true;
+						break;
+					case WindowEvent::WindowUpdated:
+						// The window system already updated the table
+						if(windowEvent.mChangedFields & ~WindowEvent::Content)
+						{
+							mFrameScheduler.notifyMotion(now);
+							windowsChanged = true;
+						}
+						else
+						{
+							mFrameScheduler.notifyContent(now);
+						}
+						break;
+				}
+			}
+		}
+		while(numWindowEvents == BX_COUNTOF(mWindowEvents));
+
+		if(windowsChanged) { updateWindowMetrics(); }
+	}
+
+	void updateWindowMetrics()
+	{
+		// Every window has a BGRA texture of its size
+		int64_t textureBytes = 0;
+		for(auto&& pair: mWindows)
+		{
+			textureBytes += (int64_t)pair.second.mWidth * pair.second.mHeight * 4;
+		}
+
+		gWindowsMetric.set((int64_t)mWindows.size());
+		gWindowGroupsMetric.set((int64_t)mWindowGroups.getPIDs().size());
+		gTextureBytesMetric.set(textureBytes);
+	}
+
+	// The controller jobs must be done, they change the windows
+	unsigned int scheduleTransforms()
+	{
+		mWindowGroups.getDrawItems(mWindows, mDrawItems);
+
+		unsigned int numItems = (unsigned int)mDrawItems.size();
+		unsigned int batchSize = std::max(
+			gMinTransformBatchSize,
+			(numItems + gMaxTransformBatches - 1) / gMaxTransformBatches
+		);
+		unsigned int numBatches = 0;
+		for(unsigned int begin = 0; begin < numItems; begin += batchSize)
+		{
+			TransformBatch& batch = mTransformBatches[numBatches];
+			batch.mApp = this;
+			batch.mBegin = begin;
+			batch.mEnd = std::min(begin + batchSize, numItems);
+
+			JobSystem::Job* job = mJobSystem.create(
+				"transform", computeTransforms, &batch
+			);
+			mJobSystem.schedule(job);
+			mTransformJobs[numBatches++] = job;
+		}
+
+		return numBatches;
+	}
+
+	static void computeTransforms(void* userData)
+	{
+		const TransformBatch& batch = *static_cast<TransformBatch*>(userData);
+		Application& app = *batch.mApp;
+
+		app.mDesktopSpace.computeTransforms(
+			&app.mDrawItems[batch.mBegin], batch.mEnd - batch.mBegin
+		);
+	}
+
+	StartupTask& addStartupTask(
+		const char* name,
+		const char* componentName,
+		StartupTask::Fn fn,
+		void* component
 	)
 	{
-		bgfx::setTransform(transform);
-		bgfx::setVertexBuffer(mQuad);
-		bgfx::setIndexBuffer(mQuadIndices);
-		bgfx::setTexture(0, mTextureUniform, texture);
-		float quadInfo[] = { width, height, invertedY ? 1.f : 0.f, 0.f };
-		bgfx::setUniform(mQuadInfoUniform, quadInfo, 1);
+		StartupTask task;
+		task.mApp = this;
+		task.mFn = fn;
+		task.mComponent = component;
+		task.mName = name;
+		task.mComponentName = componentName;
+		task.mJob = NULL;
+		task.mStart = bx::getHPCounter();
+		task.mEnd = task.mStart;
+		task.mSucceeded = false;
+		mStartupTasks.push_back(task);
+
+		return mStartupTasks.back();
 	}
 
-	void onWindowAdded(const WindowEvent& event)
+	StartupTask& spawnStartupTask(
+		const char* name,
+		const char* componentName,
+		StartupTask::Fn fn,
+		void* component
+	)
 	{
-		WindowGroup& group = findWindowGroup(event.mInfo.mPID);
-		group.mMembers.push_back(event.mWindow);
-		mWindows.insert(std::make_pair(event.mWindow, event.mInfo));
+		StartupTask& task = addStartupTask(name, componentName, fn, component);
+		task.mJob = mJobSystem.create(name, runStartupTask, &task);
+		mJobSystem.schedule(task.mJob);
+
+		return task;
 	}
 
-	void onWindowRemoved(const WindowEvent& event)
+	StartupTask& beginStartupPhase(const char* name)
 	{
-		WindowInfo wndInfo = mWindows[event.mWindow];
-		mWindows.erase(event.mWindow);
+		return addStartupTask(name, NULL, NULL, NULL);
+	}
 
-		if(event.mWindow == mFocusedWindow) { mFocusedWindow = 0; }
+	void endStartupPhase(StartupTask& task)
+	{
+		task.mEnd = bx::getHPCounter();
+		task.mSucceeded = true;
+	}
 
-		WindowGroup& group = findWindowGroup(wndInfo.mPID);
-		group.mMembers.remove(event.mWindow);
-		if(group.mMembers.empty())
+	void waitStartupTasks()
+	{
+		for(StartupTask& task: mStartupTasks)
 		{
-			mWindowGroups.erase(wndInfo.mPID);
-			auto itr = std::find(mPIDs.begin(), mPIDs.end(), wndInfo.mPID);
-			if(itr != mPIDs.end()) { mPIDs.erase(itr); }
+			mJobSystem.wait(task.mJob);
+			// Jobs are recycled by the main loop
+			task.mJob = NULL;
 		}
 	}
 
-	void onWindowUpdated(const WindowEvent& event)
+	// Window systems which were probed but not chosen
+	void shutdownProbedWindowSystems()
 	{
-		mWindows[event.mWindow] = event.mInfo;
+		for(StartupTask& task: mStartupTasks)
+		{
+			if(task.mFn != probeWindowSystem || !task.mSucceeded) { continue; }
+
+			IWindowSystem* winsys = static_cast<IWindowSystem*>(task.mComponent);
+			if(winsys != mWindowSystem) { winsys->shutdown(); }
+			task.mSucceeded = false;
+		}
 	}
 
-	WindowGroup& findWindowGroup(uintptr_t pid)
+	void reportStartup(int64_t firstFrameTime)
 	{
-		auto itr = mWindowGroups.find(pid);
-		if(itr == mWindowGroups.end())
+		double toMs = 1000.0 / (double)bx::getHPFrequency();
+
+		XVR_LOG(Info, "Startup timings (start, duration):");
+		for(const StartupTask& task: mStartupTasks)
 		{
-			WindowGroup group;
-			float relTransform[16];
-			bx::mtxTranslate(relTransform, 0.f, 0.f, -mPlacementDistance);
-			float headTransform[16];
-			mHMD->getHeadTransform(headTransform);
-			bx::mtxMul(group.mTransform, relTransform, headTransform);
+			XVR_LOG(Info,
+				"  ", std::left, std::setw(16), task.mName,
+				std::setw(12), task.mComponentName ? task.mComponentName : "",
+				std::right, std::fixed, std::setprecision(2),
+				std::setw(9), (double)(task.mStart - mStartTime) * toMs, " ms",
+				std::setw(9), (double)(task.mEnd - task.mStart) * toMs, " ms"
+			);
+		}
+		XVR_LOG(Info,
+			"Time to first frame: ",
+			std::fixed, std::setprecision(2),
+			(double)(firstFrameTime - mStartTime) * toMs, " ms"
+		);
+	}
+
+	static void runStartupTask(void* userData)
+	{
+		StartupTask& task = *static_cast<StartupTask*>(userData);
+		task.mStart = bx::getHPCounter();
+		task.mSucceeded = task.mFn(*task.mApp, task.mComponent);
+		task.mEnd = bx::getHPCounter();
+	}
+
+	static bool initHMD(Application& app, void* component)
+	{
+		return static_cast<IHMD*>(component)->init(app.mHMDCfg);
+	}
+
+	static bool probeWindowSystem(Application& app, void* component)
+	{
+		BX_UNUSED(app);
+		IWindowSystem* winsys = static_cast<IWindowSystem*>(component);
+		if(winsys->probe()) { return true; }
+
+		XVR_LOG(Info, winsys->getName(), " is not available");
+		winsys->shutdown();
+		return false;
+	}
+
+	static bool initController(Application& app, void* component)
+	{
+		IController* controller = static_cast<IController*>(component);
+		if(controller->init(app.mControllerCfg)) { return true; }
+
+		controller->shutdown();
+		return false;
+	}
+
+	static void updateHMD(void* userData)
+	{
+		XVR_PROFILE_SCOPE("hmd update");
+		Application* app = static_cast<Application*>(userData);
+		int64_t sampleTime = bx::getHPCounter();
+		app->mHMD->update();
+		app->mLatency.poseSampled(sampleTime);
+	}
 
-			auto itr2 = mWindowGroups.insert(std::make_pair(pid, group));
-			mPIDs.push_back(pid);
+	static void updateController(void* userData)
+	{
+		const ControllerUpdate& update =
+			*static_cast<ControllerUpdate*>(userData);
+		ProfileScope scope(update.mMarker);
+		update.mController->update();
+	}
 
-			return itr2.first->second;
+	// Render thread CPU time of the last rendered frame in seconds, 0 when
+	// unknown
+	static double getLastCpuTime()
+	{
+		const bgfx::Stats* stats = bgfx::getStats();
+		if(stats->cpuTimerFreq <= 0 || stats->cpuTimeEnd <= stats->cpuTimeBegin)
+		{
+			return 0.0;
 		}
-		else
+
+		return (double)(stats->cpuTimeEnd - stats->cpuTimeBegin)
+			/ (double)stats->cpuTimerFreq;
+	}
+
+	// GPU time of the last rendered frame in seconds, 0 when unknown
+	static double getLastGpuTime()
+	{
+		const bgfx::Stats* stats = bgfx::getStats();
+		if(stats->gpuTimerFreq <= 0 || stats->gpuTimeEnd <= stats->gpuTimeBegin)
+		{
+			return 0.0;
+		}
+
+		return (double)(stats->gpuTimeEnd - stats->gpuTimeBegin)
+			/ (double)stats->gpuTimerFreq;
+	}
+
+	// Count when no format was given, Unknown when it is invalid
+	static bgfx::TextureFormat::Enum parseTextureFormat(const char* name)
+	{
+		if(name == NULL) { return bgfx::TextureFormat::Count; }
+
+		for(const TextureFormatName& format: gTextureFormats)
 		{
-			return itr->second;
+			if(bx::stricmp(format.mName, name) == 0) { return format.mFormat; }
 		}
+
+		return bgfx::TextureFormat::Unknown;
+	}
+
+	void printJobTimings(uint16_t row)
+	{
+		const JobTiming* timings;
+		unsigned int numTimings = mJobSystem.getTimings(&timings);
+		double toMs = 1000.0 / (double)bx::getHPFrequency();
+
+		for(unsigned int i = 0; i < numTimings; ++i)
+		{
+			// Batches of the same job are reported together
+			bool seen = false;
+			for(unsigned int j = 0; j < i; ++j)
+			{
+				seen |= timings[j].mName == timings[i].mName;
+			}
+			if(seen) { continue; }
+
+			int64_t total = 0;
+			unsigned int count = 0;
+			for(unsigned int j = i; j < numTimings; ++j)
+			{
+				if(timings[j].mName != timings[i].mName) { continue; }
+
+				total += timings[j].mDuration;
+				++count;
+			}
+
+			bgfx::dbgTextPrintf(0, row++, 0x0f, "%-12s %7.3f ms (%u job(s))",
+				timings[i].mName, (double)total * toMs, count);
+		}
+	}
+
+	void printProfiler(uint16_t row)
+	{
+		double toMs = 1000.0 / (double)bx::getHPFrequency();
+
+		bgfx::dbgTextPrintf(0, row++, 0x0f, "%-20s %8s %8s %8s",
+			"stage", "avg ms", "max ms", "calls");
+		unsigned int numMarkers = Profiler::getNumMarkers();
+		for(unsigned int i = 0; i < numMarkers; ++i)
+		{
+			int64_t average, maximum;
+			Profiler::getMarkerStats(i, average, maximum);
+			bgfx::dbgTextPrintf(0, row++, 0x0f, "%-20s %8.3f %8.3f %8.1f",
+				Profiler::getMarkerName(i),
+				(double)average * toMs, (double)maximum * toMs,
+				Profiler::getAverageCalls(i));
+		}
+
+		int64_t frameTimes[gGraphWidth];
+		unsigned int numFrames =
+			Profiler::getFrameTimes(frameTimes, gGraphWidth);
+		int64_t maxFrameTime = 1;
+		for(unsigned int i = 0; i < numFrames; ++i)
+		{
+			maxFrameTime = std::max(maxFrameTime, frameTimes[i]);
+		}
+
+		++row;
+		bgfx::dbgTextPrintf(0, row++, 0x0f,
+			"Latency: motion-to-photon %.2f ms, content-to-photon %.2f ms",
+			mLatency.getMotionToPhoton() * 1000.0,
+			mLatency.getContentToPhoton() * 1000.0);
+		bgfx::dbgTextPrintf(0, row++, 0x0f,
+			"Allocations: main %u, render %u, workers %u per frame",
+			(unsigned int)mMainFrameAllocations,
+			(unsigned int)mRenderFrameAllocations,
+			(unsigned int)mWorkerFrameAllocations);
+
+		++row;
+		bgfx::dbgTextPrintf(0, row++, 0x0f, "Frame time (max %.2f ms)",
+			(double)maxFrameTime * toMs);
+		// One column per frame, oldest on the left
+		char line[gGraphWidth + 1];
+		for(unsigned int level = gGraphHeight; level > 0; --level)
+		{
+			for(unsigned int i = 0; i < numFrames; ++i)
+			{
+				int64_t height = (frameTimes[i] * gGraphHeight + maxFrameTime - 1)
+					/ maxFrameTime;
+				line[i] = height >= (int64_t)level ? '#' : ' ';
+			}
+			line[numFrames] = '\0';
+			bgfx::dbgTextPrintf(0, row++, 0x0a, "|%s", line);
+		}
+	}
+
+	template<typename T>
+	void loadTexturedQuad(
+		const float* transform,
+		T texture,
+		float width, float height,
+		bool invertedY,
+		bool lateLatched,
+		const float* texRect
+	)
+	{
+		bgfx::setTransform(transform);
+		bgfx::setVertexBuffer(mQuad);
+		bgfx::setIndexBuffer(mQuadIndices);
+		bgfx::setTexture(0, mTextureUniform, texture);
+		if(lateLatched)
+		{
+			bgfx::setTexture(1, mHeadPoseUniform, mLateLatch.getTexture());
+		}
+		float quadInfo[] = {
+			width, height, invertedY ? 1.f : 0.f, lateLatched ? 1.f : 0.f
+		};
+		bgfx::setUniform(mQuadInfoUniform, quadInfo, 1);
+		bgfx::setUniform(mTexRectUniform, texRect, 1);
+	}
+
+	void onWindowAdded(const WindowEvent& event)
+	{
+		bool created;
+		WindowGroup& group =
+			mWindowGroups.addWindow(event.mPID, event.mWindow, created);
+		if(!created) { return; }
+
+		// New groups are placed in front of the viewer
+		float relTransform[16];
+		bx::mtxTranslate(relTransform, 0.f, 0.f, -mPlacementDistance);
+		float headTransform[16];
+		mHMD->getHeadTransform(headTransform);
+		bx::mtxMul(group.mTransform, relTransform, headTransform);
+	}
+
+	void onWindowRemoved(const WindowEvent& event)
+	{
+		if(event.mWindow == mFocusedWindow) { mFocusedWindow = 0; }
+
+		mWindowGroups.removeWindow(event.mPID, event.mWindow);
 	}
 
 	static int32_t renderThread(void* userData)
 	{
 		XVR_LOG(Info, "Render thread started");
+		Trace::setThreadName("Render thread");
 		Application* app = static_cast<Application*>(userData);
 
 		// Ensure that this thread is registered as the render thread before
@@ -709,16 +1686,48 @@ private:
 		bgfx::renderFrame();
 		app->mHMD->initRenderer();
 		app->mWindowSystem->initRenderer();
+		app->mLateLatch.initRenderer();
+		app->mReprojection.initRenderer();
 		app->mRenderThreadReadySem.post();
 		XVR_LOG(Info, "Initialization completed, entering render loop");
 
 		while(true)
 		{
-			app->mHMD->beginRender();
-			app->mWindowSystem->beginRender();
-			bgfx::RenderFrame::Enum renderStatus = bgfx::renderFrame();
-			app->mWindowSystem->endRender();
-			app->mHMD->endRender();
+			{
+				XVR_TRACE_SCOPE("wait for frame");
+				// Fills in frames the main thread missed
+				app->mReprojection.waitForFrame();
+			}
+			{
+				XVR_PROFILE_SCOPE("begin render");
+				app->mHMD->beginRender();
+				app->mWindowSystem->beginRender();
+				// Samples the pose last so it is as fresh as possible
+				app->mLateLatch.beginRender();
+				app->mReprojection.beginRender();
+			}
+			bgfx::RenderFrame::Enum renderStatus;
+			{
+				XVR_PROFILE_SCOPE("render frame");
+				renderStatus = bgfx::renderFrame();
+			}
+			if(renderStatus == bgfx::RenderFrame::Render)
+			{
+				app->mLateLatch.frameRendered();
+				app->mLatency.frameRendered(
+					bx::getHPCounter(), app->mLateLatch.getLatchTime()
+				);
+			}
+			{
+				XVR_PROFILE_SCOPE("end render");
+				// Copies the frame while it is still in the back buffer
+				app->mReprojection.endRender();
+				app->mLateLatch.endRender();
+				app->mWindowSystem->endRender();
+				app->mHMD->endRender();
+			}
+
+			app->mRenderAllocations = AllocationCounter::getThreadAllocations();
 
 			if(renderStatus == bgfx::RenderFrame::Exiting)
 			{
@@ -727,8 +1736,10 @@ private:
 		}
 
 		XVR_LOG(Info, "Render loop terminated, shutting down...");
+		app->mReprojection.shutdownRenderer();
+		app->mLateLatch.shutdownRenderer();
 		app->mWindowSystem->shutdownRenderer();
-		app->mWindowSystem->shutdownRenderer();
+		app->mHMD->shutdownRenderer();
 		XVR_LOG(Info, "Render thread terminated");
 		return 0;
 	}
@@ -737,10 +1748,7 @@ private:
 	SDL_Window* mWindow;
 	bool mBgfxInitialized;
 	IWindowSystem* mWindowSystem;
-	float mHalfScreenWidth;
-	float mHalfScreenHeight;
-	float mXPixelsToMeters;
-	float mYPixelsToMeters;
+	DesktopSpace mDesktopSpace;
 	float mPlacementDistance;
 	bx::Thread mRenderThread;
 	bx::Semaphore mRenderThreadReadySem;
@@ -749,12 +1757,49 @@ private:
 	bgfx::ProgramHandle mProgram;
 	bgfx::UniformHandle mTextureUniform;
 	bgfx::UniformHandle mQuadInfoUniform;
+	bgfx::UniformHandle mHeadPoseUniform;
+	bgfx::UniformHandle mTexRectUniform;
 	WindowId mFocusedWindow;
-	std::unordered_map<WindowId, WindowInfo> mWindows;
-	std::unordered_map<PID, WindowGroup> mWindowGroups;
+	WindowTable mWindows;
+	WindowGroups mWindowGroups;
 	std::vector<IController*> mControllers;
-	std::vector<PID> mPIDs;
+	// Referenced by jobs so it must not change during a frame
+	std::vector<ControllerUpdate> mControllerUpdates;
 	std::vector<WindowId> mTmpWindows;
+	WindowEvent mWindowEvents[gWindowEventBatchSize];
+	JobSystem mJobSystem;
+	std::vector<DrawItem> mDrawItems;
+	TransformBatch mTransformBatches[gMaxTransformBatches];
+	JobSystem::Job* mTransformJobs[gMaxTransformBatches];
+	FrameScheduler mFrameScheduler;
+	LateLatch mLateLatch;
+	Reprojection mReprojection;
+	DynamicResolution mDynamicResolution;
+	HMDCfg mHMDCfg;
+	// Written by controller jobs, which never run concurrently
+	bool mSceneChanged;
+	float mLastHeadTransform[16];
+	ControllerCfg mControllerCfg;
+	int64_t mStartTime;
+	// Referenced by jobs so it must not reallocate
+	std::list<StartupTask> mStartupTasks;
+	bool mStartupReported;
+	PoseWriter mPoseWriter;
+	int64_t mLastPoseRecordTime;
+	EventRecorder mEventRecorder;
+	Benchmark mBenchmark;
+	// Points into argv
+	const char* mBenchJsonPath;
+	bool mShowProfiler;
+	MetricsServer mMetricsServer;
+	LatencyTracker mLatency;
+	// Heap allocations of the last frame
+	uint64_t mMainFrameAllocations;
+	uint64_t mRenderFrameAllocations;
+	uint64_t mWorkerFrameAllocations;
+	// Made by the render thread so far
+	std::atomic<uint64_t> mRenderAllocations;
+	std::ofstream mLogFile;
 };
 
 }